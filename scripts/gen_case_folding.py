@@ -0,0 +1,116 @@
+#! /usr/bin/env python3
+
+# Generate src/matcher/CaseFoldingTable.h from the Unicode Character Database's CaseFolding.txt:
+#   python3 scripts/gen_case_folding.py path/to/CaseFolding.txt > src/matcher/CaseFoldingTable.h
+# Uses the full case folding (statuses C and F), like the Unicode default caseless matching
+
+import sys
+
+
+def parse(path):
+    simple = {}
+    full = {}
+    version = ""
+
+    with open(path, encoding="utf-8") as file:
+        for line in file:
+            if line.startswith("# CaseFolding-") and not version:
+                version = line[len("# CaseFolding-"):].split(".txt")[0]
+
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+
+            fields = [field.strip() for field in line.split(";")]
+            code_point = int(fields[0], 16)
+            status = fields[1]
+            mapping = [int(value, 16) for value in fields[2].split()]
+
+            if status == "C":
+                simple[code_point] = mapping[0]
+            elif status == "F":
+                full[code_point] = mapping
+
+    return version, simple, full
+
+
+def to_ranges(simple):
+    """Group the mappings into runs of code points 1 or 2 apart (alternating upper and lowercase letters) with the same delta"""
+    ranges = []
+
+    for code_point in sorted(simple):
+        delta = simple[code_point] - code_point
+
+        if ranges:
+            first, last, stride, previous_delta = ranges[-1]
+
+            if previous_delta == delta:
+                if first == last and code_point - last in (1, 2):
+                    ranges[-1] = (first, code_point, code_point - last, delta)
+                    continue
+                if first != last and code_point - last == stride:
+                    ranges[-1] = (first, code_point, stride, delta)
+                    continue
+
+        ranges.append((code_point, code_point, 1, delta))
+
+    return ranges
+
+
+def utf8_literal(code_points):
+    return "".join("\\x{:02x}".format(byte) for byte in "".join(map(chr, code_points)).encode("utf-8"))
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("Usage: gen_case_folding.py path/to/CaseFolding.txt")
+
+    version, simple, full = parse(sys.argv[1])
+    ranges = to_ranges(simple)
+
+    print("#pragma once")
+    print()
+    print("#include <cstdint>")
+    print()
+    print("// Generated by scripts/gen_case_folding.py from CaseFolding-{}.txt, don't edit".format(version))
+    print()
+    print("namespace CaseFoldingTable")
+    print("{")
+    print("    /**")
+    print("    * Code points `first` to `last`, every `stride`th one, fold to the code point `delta` away")
+    print("    */")
+    print("    struct Range")
+    print("    {")
+    print("        uint32_t first;")
+    print("        uint32_t last;")
+    print("        uint32_t stride;")
+    print("        int32_t delta;")
+    print("    };")
+    print()
+    print("    /**")
+    print("    * Code point folding to several characters, as UTF-8")
+    print("    */")
+    print("    struct FullFolding")
+    print("    {")
+    print("        uint32_t codePoint;")
+    print("        const char* folded;")
+    print("    };")
+    print()
+    print("    // Sorted by first code point, ASCII excluded")
+    print("    inline constexpr Range ranges[] = {")
+    for first, last, stride, delta in ranges:
+        if first < 0x80:
+            continue
+        print("        {{0x{:x}, 0x{:x}, {}, {}}},".format(first, last, stride, delta))
+    print("    };")
+    print()
+    print("    // Sorted by code point")
+    print("    inline constexpr FullFolding fullFoldings[] = {")
+    for code_point in sorted(full):
+        print("        {{0x{:x}, \"{}\"}},".format(code_point, utf8_literal(full[code_point])))
+    print("    };")
+    print("}")
+
+
+if __name__ == "__main__":
+    main()
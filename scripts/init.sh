@@ -6,8 +6,7 @@ ogy() {
         else    # otherwise it's an error which should be printed
             echo "$out"
         fi
-    else
-        out=$($HOME/.local/bin/ogy/bin/ogy "$@")
-        echo "$out"
+    else    # run directly so the output stays a terminal and is colored
+        $HOME/.local/bin/ogy/bin/ogy "$@"
     fi
 }
\ No newline at end of file
@@ -1,13 +1,13 @@
 #include <cstddef>
-#include <iostream>
 #include "commands/Command.h"
+#include "printer/Printer.h"
 // #include <benchmark/benchmark.h>
 
 int main(int argc, char** argv)
 {
     if (argc == 1)
     {
-        std::cout << "No commands passed. Use 'ogy help' to view the available commands.\n";
+        Printer::write("No commands passed. Use 'ogy help' to view the available commands.\n");
     }
     else if (argc > 1)
     {
@@ -15,6 +15,7 @@ int main(int argc, char** argv)
         com.determineCommand();
     }
 
+    Printer::flush();
 }
 
 //Google Benchmark's main function
@@ -1,5 +1,6 @@
-#include <iostream>
+#include <charconv>
 #include <vector>
+#include <fcntl.h>
 #include <sys/stat.h>
 
 #include "Command.h"
@@ -8,13 +9,13 @@
 #include "./help/HelpCommand.h"
 #include "./find/FindCommand.h"
 #include "./change_directory/ChangeDirectoryCommand.h"
+#include "./index/IndexCommand.h"
+#include "../formatter/DateFormatter.h"
+#include "../formatter/PermissionFormatter.h"
 #include "../printer/Printer.h"
-
-#ifdef __APPLE__
-#ifndef st_mtime
-#define st_mtime st_mtimespec.tv_sec
-#endif
-#endif
+#include "../scanner/TreeWalker.h"
+#include "../utils/CpuCount.h"
+#include "../utils/IdNameCache.h"
 
 Command::Command(int argc, char** argv)
     : commandInfo(), errorMessage("")
@@ -24,6 +25,7 @@ Command::Command(int argc, char** argv)
 
     command = argv[1];
     setArgsAndFlags();
+    Printer::setPlain(plainOutput);
 }
 
 void Command::determineCommand()
@@ -33,7 +35,7 @@ void Command::determineCommand()
     switch (commandType)
     {
         case CommandType::NONE:
-            std::cout << "Command not recognized.\n";
+            Printer::write("Command not recognized.\n");
             break;
         case CommandType::HELP:
         {
@@ -41,7 +43,7 @@ void Command::determineCommand()
 
             if (!helpCom.hasValidArgsAndFlags())
             {
-                std::cout << helpCom.errorMessage;
+                Printer::write(helpCom.errorMessage);
                 return;
             }
 
@@ -56,7 +58,7 @@ void Command::determineCommand()
 
                 if (!cdCom.hasValidArgsAndFlags())
             {
-                std::cout << cdCom.errorMessage;
+                Printer::write(cdCom.errorMessage);
                 return;
             }
             
@@ -69,7 +71,7 @@ void Command::determineCommand()
 
             if (!infoCom.hasValidArgsAndFlags())
             {
-                std::cout << infoCom.errorMessage;
+                Printer::write(infoCom.errorMessage);
                 return;
             }
             
@@ -82,7 +84,7 @@ void Command::determineCommand()
 
             if (!listCom.hasValidArgsAndFlags())
             {
-                std::cout << listCom.errorMessage;
+                Printer::write(listCom.errorMessage);
                 return;
             }
 
@@ -95,15 +97,28 @@ void Command::determineCommand()
 
             if (!findCom.hasValidArgsAndFlags())
             {
-                std::cout << findCom.errorMessage;
+                Printer::write(findCom.errorMessage);
                 return;
             }
 
             findCom.execute();
             return;
         }
+        case CommandType::INDEX:
+        {
+            IndexCommand indexCom(argc, argv);
+
+            if (!indexCom.hasValidArgsAndFlags())
+            {
+                Printer::write(indexCom.errorMessage);
+                return;
+            }
+
+            indexCom.execute();
+            return;
+        }
         default:
-            std::cout << "No valid command passed\n";
+            Printer::write("No valid command passed\n");
             return;
     }
 }
@@ -112,11 +127,155 @@ void Command::setArgsAndFlags()
 {
     for (size_t i = 2; i < argc; i++)
     {
-        if (argv[i][0] == '-') flags.emplace_back(argv[i]);
+        if (argv[i][0] == '-')
+        {
+            // The only flag whose value can also be the next argument
+            if (std::string_view(argv[i]) == "--top") setTopCount(i + 1 < argc ? argv[++i] : "");
+            else if (!setGlobalFlag(argv[i])) flags.emplace_back(argv[i]);
+        }
         else args.emplace_back(argv[i]);
     }
 }
 
+bool Command::setGlobalFlag(std::string_view flag)
+{
+    const std::string_view columnsFlag = "--columns=";
+
+    if (flag.substr(0, columnsFlag.size()) == columnsFlag)
+    {
+        const std::map<std::string_view, Column> namesToColumns = {
+            {"perms", COLUMN_PERMISSIONS},
+            {"links", COLUMN_LINKS},
+            {"owner", COLUMN_OWNER},
+            {"size", COLUMN_SIZE},
+            {"modified", COLUMN_LAST_MODIFIED},
+            {"name", COLUMN_NAME}
+        };
+
+        columns = 0;
+        std::string_view list = flag.substr(columnsFlag.size());
+
+        while (!list.empty())
+        {
+            size_t end = list.find(',');
+            std::string_view name = list.substr(0, end);
+            list = end == std::string_view::npos ? std::string_view() : list.substr(end + 1);
+
+            auto it = namesToColumns.find(name);
+            if (it == namesToColumns.end())
+            {
+                errorMessage = "Unknown column '" + std::string(name) + "'. Available columns: perms, links, owner, size, modified, name.\n";
+                continue;
+            }
+            columns |= it->second;
+        }
+
+        if (columns == 0) columns = COLUMN_ALL;
+        return true;
+    }
+
+    if (flag == "--plain")
+    {
+        plainOutput = true;
+        return true;
+    }
+
+    const std::string_view formatFlag = "--format=";
+
+    if (flag.substr(0, formatFlag.size()) == formatFlag)
+    {
+        const std::map<std::string_view, OutputFormat> namesToFormats = {
+            {"table", OutputFormat::TABLE},
+            {"jsonl", OutputFormat::JSONL},
+            {"csv", OutputFormat::CSV},
+            {"tsv", OutputFormat::TSV},
+            {"nul", OutputFormat::NUL}
+        };
+
+        std::string_view name = flag.substr(formatFlag.size());
+        auto it = namesToFormats.find(name);
+
+        if (it == namesToFormats.end()) errorMessage = "Unknown format '" + std::string(name) + "'. Available formats: table, jsonl, csv, tsv, nul.\n";
+        else outputFormat = it->second;
+
+        return true;
+    }
+
+    const std::string_view sortFlag = "--sort=";
+
+    if (flag.substr(0, sortFlag.size()) == sortFlag)
+    {
+        const std::map<std::string_view, SortMode> namesToSortModes = {
+            {"size", SortMode::SIZE},
+            {"mtime", SortMode::MTIME},
+            {"name", SortMode::NAME},
+            {"ext", SortMode::EXT}
+        };
+
+        std::string_view name = flag.substr(sortFlag.size());
+        auto it = namesToSortModes.find(name);
+
+        if (it == namesToSortModes.end()) errorMessage = "Unknown sort order '" + std::string(name) + "'. Available orders: size, mtime, name, ext.\n";
+        else sortMode = it->second;
+
+        return true;
+    }
+
+    if (flag == "--reverse")
+    {
+        reverseSort = true;
+        return true;
+    }
+
+    const std::string_view topFlag = "--top=";
+
+    if (flag.substr(0, topFlag.size()) == topFlag)
+    {
+        setTopCount(flag.substr(topFlag.size()));
+        return true;
+    }
+
+    const std::string_view threadsFlag = "--threads=";
+
+    if (flag.substr(0, threadsFlag.size()) == threadsFlag)
+    {
+        numThreads = CpuCount::parseThreadCount(std::string(flag.substr(threadsFlag.size())).c_str());
+        if (numThreads == 0) errorMessage = "Invalid thread count '" + std::string(flag.substr(threadsFlag.size())) + "'. Expected a positive number.\n";
+
+        return true;
+    }
+
+    return false;
+}
+
+void Command::setTopCount(std::string_view count)
+{
+    auto result = std::from_chars(count.data(), count.data() + count.size(), topCount);
+
+    if (result.ec != std::errc() || result.ptr != count.data() + count.size() || topCount == 0)
+    {
+        topCount = 0;
+        errorMessage = "Invalid count '" + std::string(count) + "' for '--top'. Expected a positive number.\n";
+    }
+}
+
+unsigned int Command::getStatFields() const
+{
+    unsigned int fields = 0;
+
+    if (columns & COLUMN_PERMISSIONS) fields |= STAT_TYPE | STAT_MODE;
+    if (columns & COLUMN_LINKS) fields |= STAT_NLINK;
+    if (columns & COLUMN_OWNER) fields |= STAT_UID;
+    if (columns & COLUMN_SIZE) fields |= STAT_SIZE;
+    if (columns & COLUMN_LAST_MODIFIED) fields |= STAT_MTIME;
+    // The sort key might not be one of the printed columns
+    if (sortMode == SortMode::SIZE) fields |= STAT_SIZE;
+    if (sortMode == SortMode::MTIME) fields |= STAT_MTIME;
+    if (topCount > 0) fields |= getTopSortMode() == SortMode::MTIME ? STAT_MTIME : STAT_SIZE;
+
+    return fields;
+}
+
 bool Command::containsFlag(std::string_view flag)
 {
     for (const auto& f : flags)
@@ -127,78 +286,127 @@ bool Command::containsFlag(std::string_view flag)
     return false;
 }
 
-void Command::printCommonHeaders(const CommonFileInfoPadding& infoPadding)
+void Command::printCommonHeaders(const CommonFileInfoPadding& infoPadding) const
+{
+    if (columns & COLUMN_PERMISSIONS) Printer::print("Permissions", infoPadding.permissionsPadding + defaultPadding, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
+    if (columns & COLUMN_LINKS) Printer::print("Links", infoPadding.numLinksPadding + defaultPadding, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
+    if (columns & COLUMN_OWNER) Printer::print("Owner", infoPadding.ownerPadding + defaultPadding, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
+    if (columns & COLUMN_SIZE) Printer::print("Size",  infoPadding.sizePadding + defaultPadding, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
+    if (columns & COLUMN_LAST_MODIFIED) Printer::print("Last Modified", infoPadding.lastModifiedPadding + defaultPadding, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
+    if (columns & COLUMN_NAME) Printer::print("File Name", infoPadding.namePadding, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
+    Printer::newLine();
+}
+
+void Command::printCommonFileInfo(const CommonFileInfo& info, std::string_view name, const CommonFileInfoPadding& infoPadding) const
 {
-    Printer::print("Permissions", infoPadding.permissionsPadding + defaultPadding, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
-    Printer::print("Links", infoPadding.numLinksPadding + defaultPadding, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
-    Printer::print("Owner", infoPadding.ownerPadding + defaultPadding, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
-    Printer::print("Size",  infoPadding.sizePadding + defaultPadding, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
-    Printer::print("Last Modified", infoPadding.lastModifiedPadding + defaultPadding, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
-    Printer::print("File Name", infoPadding.namePadding, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
-    std::cout << "\n";
+    // Every column is formatted on the stack right before it is printed
+    FormattedField field;
+
+    if (columns & COLUMN_PERMISSIONS) Printer::print(formatPermissions(info.mode, field), infoPadding.permissionsPadding + defaultPadding, TextColor::GREEN, TextEmphasis::BOLD);
+    if (columns & COLUMN_LINKS) Printer::print(formatNumber(info.numLinks, field), infoPadding.numLinksPadding + defaultPadding, TextColor::MAGENTA, TextEmphasis::BOLD);
+    if (columns & COLUMN_OWNER) Printer::print(getOwnerName(info.uid), infoPadding.ownerPadding + defaultPadding, TextColor::CYAN, TextEmphasis::BOLD);
+    if (columns & COLUMN_SIZE) Printer::print(formatNumber(info.size, field), infoPadding.sizePadding + defaultPadding, TextColor::YELLOW, TextEmphasis::BOLD);
+    if (columns & COLUMN_LAST_MODIFIED) Printer::print(formatLastModified(info.lastModified, field), infoPadding.lastModifiedPadding + defaultPadding, TextColor::GREEN, TextEmphasis::BOLD);
+    if (columns & COLUMN_NAME) Printer::print(name, infoPadding.namePadding, TextColor::MAGENTA, TextEmphasis::BOLD);
+    Printer::newLine();
 }
 
-void Command::printCommonFileInfo(const CommonFileInfo& info, const CommonFileInfoPadding& infoPadding)
+void Command::printFileRecord(const CommonFileInfo& info, std::string_view name, std::string_view path)
 {
-    Printer::print(info.permissions, infoPadding.permissionsPadding + defaultPadding, TextColor::GREEN, TextEmphasis::BOLD);
-    Printer::print(info.numLinks, infoPadding.numLinksPadding + defaultPadding, TextColor::MAGENTA, TextEmphasis::BOLD);
-    Printer::print(info.owner, infoPadding.ownerPadding + defaultPadding, TextColor::CYAN, TextEmphasis::BOLD);
-    Printer::print(info.size, infoPadding.sizePadding + defaultPadding, TextColor::YELLOW, TextEmphasis::BOLD);
-    Printer::print(info.lastModified, infoPadding.lastModifiedPadding + defaultPadding, TextColor::GREEN, TextEmphasis::BOLD);
-    Printer::print(info.name, infoPadding.namePadding, TextColor::MAGENTA, TextEmphasis::BOLD);
-    std::cout << "\n";
+    if (outputFormat == OutputFormat::NUL)
+    {
+        // One path per record, like `find -print0`
+        Printer::write(path, std::string_view("\0", 1));
+        return;
+    }
+
+    if (recordWriter == nullptr)
+    {
+        recordWriter = std::make_unique<RecordWriter>(outputFormat);
+
+        std::vector<std::string_view> keys = {"path"};
+        if (columns & COLUMN_PERMISSIONS) keys.emplace_back("permissions");
+        if (columns & COLUMN_LINKS) keys.emplace_back("links");
+        if (columns & COLUMN_OWNER) keys.emplace_back("owner");
+        if (columns & COLUMN_SIZE) keys.emplace_back("size");
+        if (columns & COLUMN_LAST_MODIFIED) keys.emplace_back("modified");
+        if (columns & COLUMN_NAME) keys.emplace_back("name");
+        recordWriter->writeHeader(keys);
+    }
+
+    FormattedField field;
+
+    recordWriter->beginRecord();
+    recordWriter->addField("path", path);
+    if (columns & COLUMN_PERMISSIONS) recordWriter->addField("permissions", formatPermissions(info.mode, field));
+    if (columns & COLUMN_LINKS) recordWriter->addNumber("links", formatNumber(info.numLinks, field));
+    if (columns & COLUMN_OWNER) recordWriter->addField("owner", getOwnerName(info.uid));
+    if (columns & COLUMN_SIZE) recordWriter->addNumber("size", formatNumber(info.size, field));
+    if (columns & COLUMN_LAST_MODIFIED) recordWriter->addField("modified", formatLastModified(info.lastModified, field));
+    if (columns & COLUMN_NAME) recordWriter->addField("name", name);
+    recordWriter->endRecord();
 }
 
-CommonFileInfoPadding Command::getCommonFileInfoPadding(const CommonFileInfo& info)
+CommonFileInfoPadding Command::getCommonFileInfoPadding(const CommonFileInfo& info, std::string_view name)
 {
     CommonFileInfoPadding padding;
+    FormattedField field;
 
-    padding.permissionsPadding = std::max(std::string("Permissions").length(), info.permissions.length());
-    padding.numLinksPadding = std::max(std::string("Links").length(), info.numLinks.length());
-    padding.ownerPadding = std::max(std::string("Owner").length(), info.owner.length());
-    padding.sizePadding = std::max(std::string("Size").length(), info.size.length());
-    padding.lastModifiedPadding = std::max(std::string("Last Modified").length(), info.lastModified.length());
-    padding.namePadding = std::max(std::string("File Name").length(), info.name.length());
+    // Permissions always have the same length, so only the numbers and strings have to be measured
+    padding.permissionsPadding = std::max(std::string_view("Permissions").length(), PermissionFormatter::length);
+    padding.numLinksPadding = std::max(std::string_view("Links").length(), formatNumber(info.numLinks, field).length());
+    padding.ownerPadding = std::max(std::string_view("Owner").length(), getOwnerName(info.uid).length());
+    padding.sizePadding = std::max(std::string_view("Size").length(), formatNumber(info.size, field).length());
+    padding.lastModifiedPadding = std::max(std::string_view("Last Modified").length(), formatLastModified(info.lastModified, field).length());
+    padding.namePadding = std::max(std::string_view("File Name").length(), name.length());
 
     return padding;
 }
 
-std::string Command::getLastModified(const struct stat& fileStat)
+std::string_view Command::formatLastModified(time_t lastModified, FormattedField& field)
+{
+    // Thread-safe, since this also runs on the worker threads of `ls -mt`
+    field.length = DateFormatter::format(lastModified, field.data);
+
+    return field.view();
+}
+
+std::string_view Command::formatPermissions(mode_t mode, FormattedField& field)
+{
+    field.length = PermissionFormatter::format(mode, field.data);
+
+    return field.view();
+}
+
+std::string_view Command::formatNumber(long long number, FormattedField& field)
 {
-    std::string lastModified;
-    lastModified.resize(2048);
-    // char buffer[30];
-    auto const actualSize = std::strftime(lastModified.data(), lastModified.size(), "%a %d %b %Y at %H:%M", std::localtime(&fileStat.st_mtim.tv_sec));
-    lastModified.resize(actualSize);
+    auto result = std::to_chars(field.data, field.data + sizeof(field.data), number);
+    field.length = result.ptr - field.data;
 
-    return lastModified;
+    return field.view();
+}
+
+std::string_view Command::getOwnerName(uid_t uid)
+{
+    return IdNameCache::getUserName(uid);
 }
 
-std::string Command::getPermissions(const struct stat& fileStat)
-{
-    std::string permsAsString;
-    mode_t perm = fileStat.st_mode;
-    
-    // Check for directory
-    permsAsString += S_ISDIR(perm) ? "d" : "-";
-    permsAsString += " ";
-
-    // Check for owner permissions
-    permsAsString += (perm & S_IRUSR) ? "r" : "-";
-    permsAsString += (perm & S_IWUSR) ? "w" : "-";
-    permsAsString += (perm & S_IXUSR) ? "x" : "-";
-    permsAsString += " ";
-
-    // Check for group permissions
-    permsAsString += (perm & S_IRGRP) ? "r" : "-";
-    permsAsString += (perm & S_IWGRP) ? "w" : "-";
-    permsAsString += (perm & S_IXGRP) ? "x" : "-";
-    permsAsString += " ";
-
-    // Check for other permissions
-    permsAsString += (perm & S_IROTH) ? "r" : "-";
-    permsAsString += (perm & S_IWOTH) ? "w" : "-";
-    permsAsString += (perm & S_IXOTH) ? "x" : "-";
-
-    return permsAsString;
+off_t Command::getDirectorySize(int dirFd, const char* dirName)
+{
+    off_t totalSize = 0;
+    // Don't fall back to walking the current directory
+    if (dirName == nullptr || *dirName == '\0') return totalSize;
+
+    TreeWalker walker;
+
+    walker.walkAt(dirFd, dirName, [&totalSize](const WalkEntry& entry) {
+        FileStat fileStat;
+
+        // Skip entries that disappeared or can't be accessed
+        if (!statAt(entry.dirFd, entry.name.data(), STAT_SIZE | STAT_BLOCKS, fileStat)) return;
+
+        totalSize += fileStat.size;
+    });
+
+    return totalSize;
 }
\ No newline at end of file
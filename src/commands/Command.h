@@ -1,9 +1,18 @@
 #pragma once
 
+#include <cstdint>
+#include <ctime>
 #include <map>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <vector>
+#include <sys/types.h>
+
+#include "../formatter/DateFormatter.h"
+#include "../printer/RecordWriter.h"
+#include "../scanner/FileStat.h"
+#include "../sorter/FileSorter.h"
 
 enum class CommandType
 {
@@ -13,7 +22,22 @@ enum class CommandType
     CD,
     INFO,
     LS,
-    FIND
+    FIND,
+    INDEX
+};
+
+/**
+* Columns of the file info output. Only the metadata needed by the selected columns is requested from the file system
+*/
+enum Column : unsigned int
+{
+    COLUMN_PERMISSIONS = 1 << 0,
+    COLUMN_LINKS = 1 << 1,
+    COLUMN_OWNER = 1 << 2,
+    COLUMN_SIZE = 1 << 3,
+    COLUMN_LAST_MODIFIED = 1 << 4,
+    COLUMN_NAME = 1 << 5,
+    COLUMN_ALL = (1 << 6) - 1
 };
 
 struct CommandInfo
@@ -25,16 +49,62 @@ struct CommandInfo
 };
 
 /**
-* Used to store data of a file
+* Used to store data of a file. Only the raw metadata is kept, the columns are formatted when they are printed.
+* The name is stored in a buffer shared by all files of a listing (see FileInfoList)
 */
 struct CommonFileInfo
 {
-    std::string permissions;
-    std::string numLinks;
-    std::string owner;
-    std::string size;
-    std::string lastModified;
-    std::string name;
+    mode_t mode = 0;
+    nlink_t numLinks = 0;
+    uid_t uid = 0;
+    off_t size = 0;
+    time_t lastModified = 0;
+    uint32_t nameOffset = 0;
+    uint32_t nameLength = 0;
+};
+
+/**
+* Files of a listing together with the buffer holding their names
+*/
+struct FileInfoList
+{
+    std::vector<CommonFileInfo> files;
+    std::string names;
+
+    std::string_view getName(const CommonFileInfo& info) const
+    {
+        return std::string_view(names.data() + info.nameOffset, info.nameLength);
+    }
+
+    /**
+    * Store the name in the buffer and point the file's name at it
+    */
+    void setName(CommonFileInfo& info, std::string_view name)
+    {
+        info.nameOffset = static_cast<uint32_t>(names.size());
+        info.nameLength = static_cast<uint32_t>(name.size());
+        names.append(name);
+    }
+
+    void clear()
+    {
+        files.clear();
+        names.clear();
+    }
+};
+
+/**
+* Text of a single formatted column, kept on the stack while it is printed
+*/
+struct FormattedField
+{
+    char data[DateFormatter::bufferSize];
+    size_t length = 0;
+
+    std::string_view view() const
+    {
+        return std::string_view(data, length);
+    }
 };
 
 /**
@@ -61,7 +131,8 @@ public:
         {"cd", CommandType::CD},
         {"info", CommandType::INFO},
         {"ls", CommandType::LS},
-        {"find", CommandType::FIND}
+        {"find", CommandType::FIND},
+        {"index", CommandType::INDEX}
     };
 
 protected:
@@ -71,6 +142,19 @@ protected:
     std::vector<std::string> flags;
     std::string errorMessage;
     static const int defaultPadding = 2;
+    // Set with the global `--columns=` flag
+    unsigned int columns = COLUMN_ALL;
+    // Set with the global `--threads=` flag. 0 lets the ThreadPool pick the number of threads
+    int numThreads = 0;
+    // Set with the global `--plain` flag
+    bool plainOutput = false;
+    // Set with the global `--format=` flag
+    OutputFormat outputFormat = OutputFormat::TABLE;
+    // Set with the global `--sort=` and `--reverse` flags
+    SortMode sortMode = SortMode::NONE;
+    bool reverseSort = false;
+    // Set with the global `--top` flag. 0 keeps all files
+    size_t topCount = 0;
 
     // These need to be stored to pass them to child classes
     int argc;
@@ -83,12 +167,71 @@ protected:
     virtual void execute() {};
     virtual bool hasValidArgsAndFlags() {return false;};
     bool containsFlag(std::string_view flag);
-    static void printCommonHeaders(const CommonFileInfoPadding& infoPadding);
-    static void printCommonFileInfo(const CommonFileInfo& info, const CommonFileInfoPadding& infoPadding);
-    static CommonFileInfoPadding getCommonFileInfoPadding(const CommonFileInfo& info);
-    static std::string getLastModified(const struct stat& fileStat);
-    static std::string getPermissions(const struct stat& fileStat);
+    void printCommonHeaders(const CommonFileInfoPadding& infoPadding) const;
+    void printCommonFileInfo(const CommonFileInfo& info, std::string_view name, const CommonFileInfoPadding& infoPadding) const;
+
+    /**
+    * Print the file as one record in the selected `--format=`, instead of as a table row. The CSV/TSV header is written before the first record
+    */
+    void printFileRecord(const CommonFileInfo& info, std::string_view name, std::string_view path);
+
+    bool isTableFormat() const
+    {
+        return outputFormat == OutputFormat::TABLE;
+    }
+    static CommonFileInfoPadding getCommonFileInfoPadding(const CommonFileInfo& info, std::string_view name);
+
+    /**
+    * Format a column into `field` and return the text
+    */
+    static std::string_view formatLastModified(time_t lastModified, FormattedField& field);
+    static std::string_view formatPermissions(mode_t mode, FormattedField& field);
+    static std::string_view formatNumber(long long number, FormattedField& field);
+
+    /**
+    * Name of the user with the id, or "-" if it can't be found. Cached for the whole process, so it can be called for every file
+    */
+    static std::string_view getOwnerName(uid_t uid);
+
+    /**
+    * Order used to pick the files for `--top`: by modification time with `--sort=mtime`, otherwise by size
+    */
+    SortMode getTopSortMode() const
+    {
+        return sortMode == SortMode::MTIME ? SortMode::MTIME : SortMode::SIZE;
+    }
+
+    /**
+    * Order the files are printed in. With `--top` and no `--sort=`, the order they were picked in
+    */
+    SortMode getPrintSortMode() const
+    {
+        return (topCount > 0 && sortMode == SortMode::NONE) ? getTopSortMode() : sortMode;
+    }
+
+    /**
+    * Get the metadata fields needed to print the selected columns and to sort by `--sort=` or `--top`
+    */
+    unsigned int getStatFields() const;
+
+    /**
+    * Get the total size of all files and directories below the directory `dirName`, which is opened relative to `dirFd`. Returns 0 for an empty `dirName`
+    */
+    static off_t getDirectorySize(int dirFd, const char* dirName);
 
 private:
+    // Created on the first record
+    std::unique_ptr<RecordWriter> recordWriter;
+
     void setArgsAndFlags();
+
+    /**
+    * Handle flags which are shared by all commands. Returns false if the flag isn't a global flag
+    */
+    bool setGlobalFlag(std::string_view flag);
+
+    /**
+    * Set the number of files for `--top`, which is passed as `--top=N` or `--top N`
+    */
+    void setTopCount(std::string_view count);
 };
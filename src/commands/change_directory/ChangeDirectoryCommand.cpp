@@ -1,4 +1,3 @@
-#include <iostream>
 #include <unistd.h>
 #include <fstream>
 #include <sys/errno.h>
@@ -11,6 +10,7 @@
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/prettywriter.h"
 #include "ChangeDirectoryCommand.h"
+#include "../../printer/Printer.h"
 
 ChangeDirectoryCommand::ChangeDirectoryCommand(int argc, char** argv)
     : Command(argc, argv)
@@ -32,7 +32,7 @@ void ChangeDirectoryCommand::execute()
     // Check if the config file exists at the install directory
     if (stat(configFilePath.c_str(), &configFileStat) != 0)
     {
-        std::cout << "Config file error: " << strerror(errno) << "\n";
+        Printer::write("Config file error: ", strerror(errno), "\n");
         return;
     }
 
@@ -53,10 +53,10 @@ void ChangeDirectoryCommand::execute()
         {
             if (containsKey(doc.GetObject(), alias.c_str()))
             {
-                std::cout << recursiveValueSearch(doc.GetObject(), alias.c_str()) << "\n";
+                Printer::write(recursiveValueSearch(doc.GetObject(), alias.c_str()), "\n");
                 return;
             }
-            std::cout << "Invalid alias or path";
+            Printer::write("Invalid alias or path");
         }
 
         // Path was provided, so change to specified path
@@ -64,10 +64,10 @@ void ChangeDirectoryCommand::execute()
         {
             if (isValidPath(newPath))
             {
-                std::cout << newPath;
+                Printer::write(newPath);
                 return;
             }
-            std::cout << "Invalid alias or path";
+            Printer::write("Invalid alias or path");
         }
     }
     else if (args.size() == 2)
@@ -84,7 +84,7 @@ void ChangeDirectoryCommand::execute()
                         updatePathInConfig(doc, newPath);
                     }
                 }
-                std::cout << "Invalid path\n";
+                Printer::write("Invalid path\n");
                 return;
             }
             else
@@ -95,22 +95,22 @@ void ChangeDirectoryCommand::execute()
                     addPathToConfig(doc, newPath);
                     return;
                 }
-                std::cout << "Invalid path\n";
+                Printer::write("Invalid path\n");
                 return;
             }
         }
         else if (!hasPath)
         {
-            std::cout << "Invalid path";
+            Printer::write("Invalid path");
         }
         else
         {
-            std::cout << "Invalid path";
+            Printer::write("Invalid path");
         }
     }
     else
     {
-        std::cout << "Invalid args\n";
+        Printer::write("Invalid args\n");
     }
 }
 
@@ -262,7 +262,7 @@ bool ChangeDirectoryCommand::isValidPath(std::string path)
     if (stat(path.c_str(), &dirStat) == 0) 
     {
         if (S_ISDIR(dirStat.st_mode)) isValidDir = true;
-        else std::cout << "Not a valid subdirectory in current directory";
+        else Printer::write("Not a valid subdirectory in current directory");
     }
 
     return isValidDir;
@@ -273,7 +273,7 @@ std::string ChangeDirectoryCommand::getCurrentPath()
     char currentDir[PATH_MAX];
     if (getcwd(currentDir, sizeof(currentDir)) == nullptr)
     {
-        std::cout << "Error: " << strerror(errno) << "\n";
+        Printer::write("Error: ", strerror(errno), "\n");
         return "";
     }
 
@@ -294,7 +294,7 @@ void ChangeDirectoryCommand::updatePathInConfig(rj::Document& doc, std::string n
                 itr->value.SetString(newPath.c_str(), doc.GetAllocator());
                 jsonToFile(doc, configFilePath);
 
-                std::cout << newPath;
+                Printer::write(newPath);
                 return;
             }
         }
@@ -314,7 +314,7 @@ void ChangeDirectoryCommand::addPathToConfig(rj::Document &doc, std::string newP
     doc["paths"].PushBack(newObj, allocator);
     jsonToFile(doc, configFilePath);
 
-    std::cout << newPath;
+    Printer::write(newPath);
     return;
 }
 
@@ -1,12 +1,22 @@
 #include <algorithm>
-#include <cctype>
-#include <iostream>
+#include <iterator>
 #include <sys/errno.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <pwd.h>
-
+#include <sys/ioctl.h>
+#include <unistd.h>
 
 #include "FindCommand.h"
+#include "../../scanner/DirScanner.h"
+#include "../../scanner/ParallelWalker.h"
+#include "../../index/FileIndex.h"
+#include "../../matcher/FuzzyMatcher.h"
+#include "../../scanner/TreeWalker.h"
+#include "../../sorter/TopHeap.h"
+#include "../../utils/ParallelSort.h"
+#include "../../utils/ThreadPool.h"
+#include "../../utils/WaitGroup.h"
 
 FindCommand::FindCommand(int argc, char** argv)
     : Command(argc, argv)
@@ -14,36 +24,507 @@ FindCommand::FindCommand(int argc, char** argv)
     commandInfo.name = "find";
     commandInfo.description = "Find all files in the current directory which include `term` in their file name.";
     commandInfo.numArgs = 1;
-    commandInfo.numFlags = 1;
+    commandInfo.numFlags = 4;
 }
 
 void FindCommand::execute()
 {
-    if (containsFlag("-rec")) findFiles<RecDirIterator>();
-    else findFiles<DirIterator>();
+    if (containsFlag("--fuzzy")) findFilesFuzzy(containsFlag("-rec"));
+    else if (containsFlag("--index")) findFilesInIndex(containsFlag("-rec"));
+    else if (containsFlag("-rec") && containsFlag("-mt")) findFilesParallel();
+    else findFiles(containsFlag("-rec"));
 }
 
-CommonFileInfo FindCommand::setFileInfo(const struct stat& fileStat, const Path& entryPath)
+void FindCommand::findFilesParallel()
+{
+    Path currentPath = std::filesystem::current_path();
+
+    const unsigned int statFields = getStatFields();
+
+    ThreadPool tp(numThreads);
+    ParallelWalker walker(tp);
+
+    // Every worker collects its own matches, so nothing is shared while walking. With `--top` they only keep their best ones
+    std::vector<std::vector<FoundFile>> workerMatches(walker.getNumWorkers());
+    std::vector<TopHeap<FoundFile>> workerTops(walker.getNumWorkers(), TopHeap<FoundFile>(topCount));
+    const SortMode topSortMode = getTopSortMode();
+
+    walker.walk(currentPath.string(), [&](int worker, const WalkEntry& entry) {
+        if (!matcher.matches(entry.name)) return;
+
+        FoundFile match;
+        if (!statAt(entry.dirFd, entry.name.data(), statFields, match.fileStat)) return;
+
+        uint64_t topKey = 0;
+        if (topCount > 0)
+        {
+            // Checked before copying the path, since most matches of a large tree won't be kept
+            topKey = FileSorter::getPrimaryKey(topSortMode, match.fileStat.size, match.fileStat.lastModified);
+            if (!workerTops[worker].wouldKeep(topKey)) return;
+        }
+
+        match.path = entry.path;
+        match.nameOffset = entry.path.size() - entry.name.size();
+
+        if (topCount > 0) workerTops[worker].push(topKey, std::move(match));
+        else workerMatches[worker].emplace_back(std::move(match));
+    });
+
+    std::vector<FoundFile> matches;
+    if (topCount > 0)
+    {
+        TopHeap<FoundFile> top(topCount);
+        for (auto& workerTop : workerTops) top.merge(std::move(workerTop));
+
+        matches = top.take();
+    }
+    else
+    {
+        for (auto& foundFiles : workerMatches)
+        {
+            std::move(foundFiles.begin(), foundFiles.end(), std::back_inserter(matches));
+        }
+    }
+
+    // The workers visit the entries in no particular order, so sort by path to keep the output stable. Also the order of ties with `--sort=`
+    std::sort(matches.begin(), matches.end(), [](const FoundFile& a, const FoundFile& b) {return a.path < b.path;});
+
+    printMatches(matches, &tp, getPrintSortMode());
+}
+
+void FindCommand::findFilesInIndex(bool recursive)
+{
+    const std::string currentPath = std::filesystem::current_path().string();
+    FileIndex index;
+    std::string relativePath;
+    uint32_t currentDir;
+
+    if (!openIndex(currentPath, index, relativePath, currentDir)) return;
+
+    const unsigned int statFields = getStatFields();
+
+    std::vector<FoundFile> matches;
+    TopHeap<FoundFile> top(topCount);
+    const SortMode topSortMode = getTopSortMode();
+
+    // The whole subtree is a contiguous range of directories
+    const uint32_t lastDir = recursive ? index.getDir(currentDir).subtreeEnd : currentDir + 1;
+    std::string dirPath;
+    uint32_t dirPathDir = FileIndex::noDir;
+
+    auto visitEntry = [&](uint32_t dir, std::string_view name) {
+        if (!matcher.matches(name)) return;
+
+        // Entries come grouped by directory, so its path only has to be built once per directory with matches
+        if (dir != dirPathDir)
+        {
+            dirPath.assign(index.getRoot());
+            const std::string relativeDirPath = index.getDirPath(dir);
+            if (!relativeDirPath.empty())
+            {
+                if (dirPath.back() != '/') dirPath += '/';
+                dirPath += relativeDirPath;
+            }
+            if (dirPath.back() != '/') dirPath += '/';
+            dirPathDir = dir;
+        }
+
+        FoundFile match;
+        match.path = dirPath;
+        match.path.append(name);
+        match.nameOffset = dirPath.size();
+
+        // Files removed since the index was built are skipped
+        if (!statAt(AT_FDCWD, match.path.c_str(), statFields, match.fileStat)) return;
+
+        if (topCount > 0) top.push(FileSorter::getPrimaryKey(topSortMode, match.fileStat.size, match.fileStat.lastModified), std::move(match));
+        else matches.emplace_back(std::move(match));
+    };
+
+    const uint32_t firstEntry = index.getDir(currentDir).firstEntry;
+    const uint32_t lastEntry = index.getDir(lastDir - 1).firstEntry + index.getDir(lastDir - 1).numEntries;
+    std::vector<uint32_t> candidates;
+
+    // Terms and patterns with an ASCII literal of at least one trigram only have to be checked against the names which contain all of its trigrams.
+    // Other terms can be folded differently than the names containing them, so every name is checked
+    if (index.findCandidates(matcher.getRequiredLiteral(), firstEntry, lastEntry, candidates))
+    {
+        std::string name;
+
+        for (uint32_t entry : candidates)
+        {
+            index.getName(entry, name);
+            visitEntry(index.getEntryDir(entry), name);
+        }
+    }
+    else
+    {
+        index.forEachEntry(currentDir, lastDir, [&](uint32_t dir, uint32_t, std::string_view name) {visitEntry(dir, name);});
+    }
+
+    if (topCount > 0)
+    {
+        matches = top.take();
+        std::sort(matches.begin(), matches.end(), [](const FoundFile& a, const FoundFile& b) {return a.path < b.path;});
+    }
+
+    printMatches(matches, nullptr, getPrintSortMode());
+}
+
+bool FindCommand::openIndex(const std::string& currentPath, FileIndex& index, std::string& relativePath, uint32_t& currentDir)
+{
+    if (!index.openFor(currentPath, relativePath))
+    {
+        Printer::write("No index found for '", currentPath, "'. Build one with 'ogy index build {path}'.\n");
+        return false;
+    }
+
+    currentDir = index.findDir(relativePath);
+    if (currentDir == FileIndex::noDir)
+    {
+        Printer::write("'", currentPath, "' isn't in the index of '", index.getRoot(), "'. Update it with 'ogy index build {path}'.\n");
+        return false;
+    }
+
+    return true;
+}
+
+void FindCommand::findFiles(bool recursive)
+{
+    Path currentPath = std::filesystem::current_path();
+    int index = 1;
+    bool found = false;
+    // With `--sort=`, `--reverse` or `--top` the matches can only be printed once all of them are found
+    const bool sorted = sortMode != SortMode::NONE || reverseSort || topCount > 0;
+    std::vector<FoundFile> matches;
+    TopHeap<FoundFile> top(topCount);
+    const SortMode topSortMode = getTopSortMode();
+
+    // Only matching entries are looked up, and only for the fields of the printed columns
+    const unsigned int statFields = getStatFields();
+
+    auto visitEntry = [&](const WalkEntry& entry) {
+        if (!matcher.matches(entry.name)) return;
+
+        FileStat fileStat;
+
+        // Check if valid file info has been returned
+        if (!statAt(entry.dirFd, entry.name.data(), statFields, fileStat))
+        {
+            Printer::write("Error: ", std::strerror(errno), "\n");
+            return;
+        }
+
+        if (topCount > 0)
+        {
+            const uint64_t topKey = FileSorter::getPrimaryKey(topSortMode, fileStat.size, fileStat.lastModified);
+            if (top.wouldKeep(topKey)) top.push(topKey, FoundFile{std::string(entry.path), entry.path.size() - entry.name.size(), fileStat});
+            return;
+        }
+
+        if (sorted)
+        {
+            matches.push_back(FoundFile{std::string(entry.path), entry.path.size() - entry.name.size(), fileStat});
+            return;
+        }
+
+        printMatch(fileStat, entry.name, entry.path, index);
+
+        index++;
+        found = true;
+    };
+
+    if (recursive)
+    {
+        TreeWalker walker;
+        walker.walk(currentPath.string(), visitEntry);
+    }
+    else
+    {
+        DirScanner scanner;
+        if (!scanner.open(currentPath.c_str()))
+        {
+            Printer::write("Error: ", std::strerror(scanner.getError()), "\n");
+            return;
+        }
+
+        std::string entryPath = currentPath.string();
+        if (entryPath.back() != '/') entryPath += '/';
+        const size_t dirPathLength = entryPath.size();
+
+        DirEntry entry;
+        while (scanner.next(entry))
+        {
+            entryPath.resize(dirPathLength);
+            entryPath.append(entry.name);
+
+            visitEntry(WalkEntry{entry.name, entryPath, entry.type, entry.inode, 0, scanner.getFd()});
+        }
+    }
+
+    if (topCount > 0)
+    {
+        matches = top.take();
+        // The heap doesn't keep the walk order, so sort by path like findFilesParallel does to keep the order of ties stable
+        std::sort(matches.begin(), matches.end(), [](const FoundFile& a, const FoundFile& b) {return a.path < b.path;});
+    }
+
+    if (sorted) printMatches(matches, nullptr, getPrintSortMode());
+    else if (!found && isTableFormat()) Printer::print("No file(s) found\n", 0, TextColor::WHITE, TextEmphasis::BOLD);
+}
+
+void FindCommand::findFilesFuzzy(bool recursive)
+{
+    const std::string currentPath = std::filesystem::current_path().string();
+    const FuzzyMatcher fuzzyMatcher(args[0]);
+    ThreadPool tp(numThreads);
+
+    // Paths relative to the current directory, which are what is scored and what the query is typed against
+    FuzzyCandidates candidates;
+    const std::string rootPath = currentPath.back() == '/' ? currentPath : currentPath + "/";
+    const size_t rootLength = rootPath.size();
+
+    if (containsFlag("--index"))
+    {
+        FileIndex index;
+        std::string relativePath;
+        uint32_t currentDir;
+
+        if (!openIndex(currentPath, index, relativePath, currentDir)) return;
+
+        const uint32_t lastDir = recursive ? index.getDir(currentDir).subtreeEnd : currentDir + 1;
+        // Directory paths in the index are relative to its root
+        const size_t prefixLength = relativePath.empty() ? 0 : relativePath.size() + 1;
+        std::string path;
+        size_t dirPathLength = 0;
+        uint32_t pathDir = FileIndex::noDir;
+
+        index.forEachEntry(currentDir, lastDir, [&](uint32_t dir, uint32_t, std::string_view name) {
+            if (dir != pathDir)
+            {
+                const std::string dirPath = index.getDirPath(dir);
+                path.assign(dirPath.size() > prefixLength ? dirPath.substr(prefixLength) + "/" : "");
+                dirPathLength = path.size();
+                pathDir = dir;
+            }
+
+            path.resize(dirPathLength);
+            path.append(name);
+            if (fuzzyMatcher.isCandidate(path)) candidates.add(path);
+        });
+    }
+    else if (recursive && containsFlag("-mt"))
+    {
+        ParallelWalker walker(tp);
+        std::vector<FuzzyCandidates> workerCandidates(walker.getNumWorkers());
+
+        walker.walk(currentPath, [&](int worker, const WalkEntry& entry) {
+            const std::string_view path = entry.path.substr(rootLength);
+            if (fuzzyMatcher.isCandidate(path)) workerCandidates[worker].add(path);
+        });
+
+        std::vector<std::string_view> paths;
+        for (const auto& found : workerCandidates)
+        {
+            for (size_t i = 0; i < found.size(); i++) paths.emplace_back(found.get(i));
+        }
+
+        // The workers find the paths in no particular order, so sort them to keep the order of equal scores stable
+        ParallelSort::sort(paths, std::less<std::string_view>(), &tp);
+        for (std::string_view path : paths) candidates.add(path);
+    }
+    else if (recursive)
+    {
+        TreeWalker walker;
+        walker.walk(currentPath, [&](const WalkEntry& entry) {
+            const std::string_view path = entry.path.substr(rootLength);
+            if (fuzzyMatcher.isCandidate(path)) candidates.add(path);
+        });
+    }
+    else
+    {
+        DirScanner scanner;
+        if (!scanner.open(currentPath.c_str()))
+        {
+            Printer::write("Error: ", std::strerror(scanner.getError()), "\n");
+            return;
+        }
+
+        DirEntry entry;
+        while (scanner.next(entry))
+        {
+            if (fuzzyMatcher.isCandidate(entry.name)) candidates.add(entry.name);
+        }
+    }
+
+    printFuzzyMatches(fuzzyMatcher, candidates, rootPath, tp);
+}
+
+void FindCommand::printFuzzyMatches(const FuzzyMatcher& fuzzyMatcher, const FuzzyCandidates& candidates, const std::string& rootPath, ThreadPool& tp)
+{
+    const size_t count = topCount > 0 ? topCount : defaultFuzzyCount;
+    const size_t numChunks = (candidates.size() + fuzzyChunkSize - 1) / fuzzyChunkSize;
+
+    // Every chunk is scored on the pool and keeps only its best matches, so memory stays bounded by the count per chunk
+    std::vector<TopHeap<uint64_t>> chunkTops(numChunks, TopHeap<uint64_t>(count));
+    WaitGroup pendingChunks(static_cast<int>(numChunks));
+
+    for (size_t chunk = 0; chunk < numChunks; chunk++)
+    {
+        tp.submit([&, chunk]() {
+            FuzzyMatcher::Buffers buffers;
+            TopHeap<uint64_t>& top = chunkTops[chunk];
+            const size_t end = std::min(candidates.size(), (chunk + 1) * fuzzyChunkSize);
+
+            for (size_t i = chunk * fuzzyChunkSize; i < end; i++)
+            {
+                const std::string_view path = candidates.get(i);
+                const int score = fuzzyMatcher.score(path, buffers);
+                if (score == FuzzyMatcher::noMatch) continue;
+
+                const uint64_t key = getFuzzyKey(score, path.size(), static_cast<uint32_t>(i));
+                top.push(key, key);
+            }
+
+            pendingChunks.done();
+        });
+    }
+
+    pendingChunks.wait();
+
+    TopHeap<uint64_t> top(count);
+    for (auto& chunkTop : chunkTops) top.merge(std::move(chunkTop));
+
+    std::vector<uint64_t> ranked = top.take();
+    std::sort(ranked.begin(), ranked.end());
+
+    const unsigned int statFields = getStatFields();
+    std::vector<FoundFile> matches;
+    matches.reserve(ranked.size());
+
+    for (uint64_t key : ranked)
+    {
+        const std::string_view path = candidates.get(static_cast<uint32_t>(key));
+
+        FoundFile match;
+        match.path = rootPath;
+        match.path.append(path);
+        const size_t slash = path.rfind('/');
+        match.nameOffset = rootPath.size() + (slash == std::string_view::npos ? 0 : slash + 1);
+
+        // Skip files whose stat failed, because they were removed since they were indexed or walked, or can't be accessed
+        if (!statAt(AT_FDCWD, match.path.c_str(), statFields, match.fileStat)) continue;
+
+        matches.emplace_back(std::move(match));
+    }
+
+    // Printed best match first, unless another order is passed
+    printMatches(matches, &tp, sortMode);
+}
+
+uint64_t FindCommand::getFuzzyKey(int score, size_t pathLength, uint32_t index)
+{
+    // Smaller keys are kept, so the score is inverted. Equal scores prefer shorter paths, then the order they were found in
+    const uint64_t maxScore = (1 << 24) - 1;
+    const uint64_t invertedScore = maxScore - std::min(static_cast<uint64_t>(score), maxScore);
+
+    return (invertedScore << 40) | (static_cast<uint64_t>(std::min<size_t>(pathLength, 0xff)) << 32) | index;
+}
+
+void FindCommand::printMatches(const std::vector<FoundFile>& matches, ThreadPool* threadPool, SortMode printSortMode)
+{
+    if (matches.empty() && isTableFormat())
+    {
+        Printer::print("No file(s) found\n", 0, TextColor::WHITE, TextEmphasis::BOLD);
+        return;
+    }
+
+    std::vector<uint32_t> order;
+
+    if (printSortMode == SortMode::NONE)
+    {
+        order.resize(matches.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = static_cast<uint32_t>(i);
+        if (reverseSort) std::reverse(order.begin(), order.end());
+    }
+    else
+    {
+        FileSorter sorter(printSortMode, reverseSort);
+        sorter.reserve(matches.size());
+
+        for (const auto& match : matches)
+        {
+            sorter.add(std::string_view(match.path).substr(match.nameOffset), match.fileStat.size, match.fileStat.lastModified);
+        }
+
+        order = sorter.sort(threadPool);
+    }
+
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const FoundFile& match = matches[order[i]];
+        printMatch(match.fileStat, std::string_view(match.path).substr(match.nameOffset), match.path, static_cast<int>(i + 1));
+    }
+}
+
+void FindCommand::printMatch(const FileStat& fileStat, std::string_view fileName, std::string_view filePath, int index)
+{
+    // Set file info
+    CommonFileInfo info = setFileInfo(fileStat);
+
+    if (!isTableFormat())
+    {
+        printFileRecord(info, fileName, filePath);
+        return;
+    }
+
+    // Get the length of the longest string to set the width of each column (to line them up)
+    CommonFileInfoPadding padding = Command::getCommonFileInfoPadding(info, fileName);
+
+    // Ensure that header length for the path can't be longer than the terminal width
+    struct winsize winSize;
+    ioctl(STDOUT_FILENO, TIOCGWINSZ, &winSize);
+    int minPathInfoPadding = std::min(static_cast<int>(filePath.length()), static_cast<int>(winSize.ws_col));
+    int pathPadding = std::max(static_cast<int>(std::string("File Path").length()), minPathInfoPadding);
+    
+    // Print common headers
+    Printer::print(" ", defaultPadding + 2, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
+    Command::printCommonHeaders(padding);
+
+    // Print common file info
+    FormattedField indexField;
+    Printer::print(formatNumber(index, indexField), defaultPadding + 2, TextColor::GRAY, TextEmphasis::BOLD);
+    Command::printCommonFileInfo(info, fileName, padding);
+    
+    // Print file path header
+    Printer::print(" ", defaultPadding + 2, TextColor::GRAY, TextEmphasis::BOLD);
+    Printer::print("File Path", pathPadding, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
+    Printer::newLine();
+
+    // Print file path info
+    Printer::print(" ", defaultPadding + 2, TextColor::GRAY, TextEmphasis::BOLD);
+    Printer::print(filePath, pathPadding, TextColor::CYAN, TextEmphasis::BOLD);
+    Printer::newLine();
+}
+
+CommonFileInfo FindCommand::setFileInfo(const FileStat& fileStat)
 {
     CommonFileInfo info;
-    // Get permissions for the file
-    info.permissions = Command::getPermissions(fileStat);
-    // Get number of hard links to the file
-    info.numLinks = std::to_string(static_cast<int>(fileStat.st_nlink));
-    // Get number of hard links to the file
-    info.owner = getpwuid(fileStat.st_uid)->pw_name ? getpwuid(fileStat.st_uid)->pw_name : "-";
+
+    info.mode = fileStat.mode;
+    info.numLinks = fileStat.numLinks;
+    info.uid = fileStat.uid;
     // Get file size in bytes or number of bytes allocated to directory
-    info.size = std::to_string(fileStat.st_size);
-    // Get time and date of last modification
-    info.lastModified = Command::getLastModified(fileStat);
-    // Get file name from args
-    info.name = entryPath.filename();
+    info.size = fileStat.size;
+    info.lastModified = fileStat.lastModified;
 
     return info;
 }
 
 bool FindCommand::hasValidArgsAndFlags()
 {
+    // Set when a global flag is invalid
+    if (!errorMessage.empty()) return false;
     if (args.size() < commandInfo.numArgs)
     {
         errorMessage = "No arguments passed to 'find' command. Use 'ogy help' to view the expected arguments.\n";
@@ -59,6 +540,25 @@ bool FindCommand::hasValidArgsAndFlags()
         errorMessage = "Too many flags passed to 'find' command. Use 'ogy help' to view the expected flags.\n";
         return false;
     }
+    else if (containsFlag("--glob") + containsFlag("--regex") + containsFlag("--fuzzy") > 1)
+    {
+        errorMessage = "Use only one of '--glob', '--regex' and '--fuzzy' with the 'find' command.\n";
+        return false;
+    }
+
+    // Fuzzy queries are scored by findFilesFuzzy instead
+    if (containsFlag("--fuzzy")) return true;
+
+    NameMatcher::Mode mode = NameMatcher::Mode::SUBSTRING;
+    if (containsFlag("--glob")) mode = NameMatcher::Mode::GLOB;
+    else if (containsFlag("--regex")) mode = NameMatcher::Mode::REGEX;
+
+    // Compiled once here and shared by all searches and workers
+    if (!matcher.compile(args[0], mode))
+    {
+        errorMessage = "Invalid pattern '" + args[0] + "': " + matcher.getError() + ".\n";
+        return false;
+    }
 
     return true;
 }
\ No newline at end of file
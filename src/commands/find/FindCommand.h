@@ -2,91 +2,114 @@
 
 #include <cstring>
 #include <string>
+#include <string_view>
 #include <filesystem>
-
-#include <sys/ioctl.h>
-#include <unistd.h>
+#include <vector>
 
 #include "../Command.h"
 #include "../info/InfoCommand.h"
+#include "../../matcher/NameMatcher.h"
 #include "../../printer/Printer.h"
 
-using DirIterator = std::filesystem::directory_iterator;
-using RecDirIterator = std::filesystem::recursive_directory_iterator;
+class FileIndex;
+class FuzzyMatcher;
+class ThreadPool;
+
 using Path = std::filesystem::path;
 
+/**
+* A file matching the find term
+*/
+struct FoundFile
+{
+    std::string path;
+    size_t nameOffset;
+    FileStat fileStat;
+};
+
+/**
+* Paths for fuzzy matching, stored one after another in a single buffer
+*/
+struct FuzzyCandidates
+{
+    std::string paths;
+    std::vector<size_t> ends;
+
+    void add(std::string_view path)
+    {
+        paths.append(path);
+        ends.emplace_back(paths.size());
+    }
+
+    [[nodiscard]] size_t size() const { return ends.size(); }
+
+    [[nodiscard]] std::string_view get(size_t i) const
+    {
+        const size_t start = i == 0 ? 0 : ends[i - 1];
+        return std::string_view(paths).substr(start, ends[i] - start);
+    }
+};
+
 class FindCommand : public Command
 {
 public:
+    // Matches printed by `--fuzzy` without `--top`
+    static constexpr size_t defaultFuzzyCount = 50;
+    // Paths scored by one task of the thread pool
+    static constexpr size_t fuzzyChunkSize = 4096;
+
     FindCommand(int argc, char** argv);
     void execute() override;
     bool hasValidArgsAndFlags() override;
 
 private:
-    CommonFileInfo setFileInfo(const struct stat& fileInfo, const Path& entryPath);
+    // The term, or the pattern with `--glob` or `--regex`
+    NameMatcher matcher;
 
-    template <typename T>
-    void findFiles()
-    {
-        Path currentPath = std::filesystem::current_path();
-        int index = 1;
-        bool found = false;
-
-        for (const auto& entry : T(currentPath, std::filesystem::directory_options::skip_permission_denied))
-        {
-            // Convert the provided find term and file name to lowercase for comparison
-            std::string findTerm = args[0];
-            std::transform(findTerm.begin(), findTerm.end(), findTerm.begin(), ::tolower);
-            
-            std::string fileName = entry.path().filename().string();
-            std::transform(fileName.begin(), fileName.end(), fileName.begin(), ::tolower);
-
-            if (fileName.find(findTerm) != std::string::npos)
-            {
-                struct stat fileStat;
-            
-                // Check if valid file info has been returned
-                if (stat(entry.path().c_str(), &fileStat) != 0)
-                {
-                    std::cout << "Error: " << std::strerror(errno) << "\n";
-                    return;
-                }
-                
-                // Set file info
-                CommonFileInfo info = setFileInfo(fileStat, entry.path());
-                
-                // Get the length of the longest string to set the width of each column (to line them up)
-                CommonFileInfoPadding padding = Command::getCommonFileInfoPadding(info);
-
-                // Ensure that header length for the path can't be longer than the terminal width
-                struct winsize winSize;
-                ioctl(STDOUT_FILENO, TIOCGWINSZ, &winSize);
-                int minPathInfoPadding = std::min(static_cast<int>(entry.path().string().length()), static_cast<int>(winSize.ws_col));
-                int pathPadding = std::max(static_cast<int>(std::string("File Path").length()), minPathInfoPadding);
-                
-                // Print common headers
-                Printer::print(" ", defaultPadding + 2, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
-                Command::printCommonHeaders(padding);
-
-                // Print common file info
-                Printer::print(std::to_string(index), defaultPadding + 2, TextColor::GRAY, TextEmphasis::BOLD);
-                Command::printCommonFileInfo(info, padding);
-                
-                // Print file path header
-                Printer::print(" ", defaultPadding + 2, TextColor::GRAY, TextEmphasis::BOLD);
-                Printer::print("File Path", pathPadding, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
-                std::cout << "\n";
-
-                // Print file path info
-                Printer::print(" ", defaultPadding + 2, TextColor::GRAY, TextEmphasis::BOLD);
-                Printer::print(entry.path().string(), pathPadding, TextColor::CYAN, TextEmphasis::BOLD);
-                std::cout << "\n";
-
-                index++;
-                found = true;
-            }
-        }
-
-        if (!found) Printer::print("No file(s) found\n", 0, TextColor::WHITE, TextEmphasis::BOLD);
-    }
+    /**
+    * Get the info of a file, without its name
+    */
+    CommonFileInfo setFileInfo(const FileStat& fileInfo);
+    void findFiles(bool recursive);
+
+    /**
+    * Recursively search for matching files with a ParallelWalker. Used when `-rec` and `-mt` are passed
+    */
+    void findFilesParallel();
+
+    /**
+    * Search the names in the index of the current directory instead of walking it. Used when `--index` is passed
+    */
+    void findFilesInIndex(bool recursive);
+
+    /**
+    * Rank the paths below the current directory by how well they fuzzy match the term and print the best ones. Used when `--fuzzy` is passed
+    */
+    void findFilesFuzzy(bool recursive);
+
+    /**
+    * Score the candidates on the thread pool, keeping the best `--top` (or defaultFuzzyCount) of them, and print those. `rootPath` ends with '/'
+    */
+    void printFuzzyMatches(const FuzzyMatcher& fuzzyMatcher, const FuzzyCandidates& candidates, const std::string& rootPath, ThreadPool& tp);
+
+    /**
+    * Key for a TopHeap of fuzzy matches, ordered by descending score
+    */
+    static uint64_t getFuzzyKey(int score, size_t pathLength, uint32_t index);
+
+    /**
+    * Open the index containing the current directory and find the directory in it. Prints why if that isn't possible
+    */
+    bool openIndex(const std::string& currentPath, FileIndex& index, std::string& relativePath, uint32_t& currentDir);
+
+    /**
+    * Print the info of a file whose name contains the find term
+    */
+    void printMatch(const FileStat& fileStat, std::string_view fileName, std::string_view filePath, int index);
+
+    /**
+    * Print all matches sorted by `printSortMode`, or in the order they are in for SortMode::NONE.
+    * The sort runs on the thread pool if one is passed
+    */
+    void printMatches(const std::vector<FoundFile>& matches, ThreadPool* threadPool, SortMode printSortMode);
 };
\ No newline at end of file
@@ -1,5 +1,3 @@
-#include <iostream>
-
 #include "HelpCommand.h"
 #include "../../printer/Printer.h"
 
@@ -15,33 +13,36 @@ HelpCommand::HelpCommand(int argc, char** argv)
 void HelpCommand::execute()
 {
     Printer::print("\n------------------------------", 0, TextColor::WHITE, TextEmphasis::BOLD);
-    std::cout << "\n\n";
+    Printer::write("\n\n");
     Printer::print("Ogy is your very own command line companion!\n\n", 0, TextColor::WHITE, TextEmphasis::BOLD);
     Printer::print("Its purpose is to offer you a range of helpful commands that will make your life easier. Some of these commands are improved versions of existing commands while others offer new functionalities that make working with the command line more convenient.\n", 0, TextColor::WHITE, TextEmphasis::BOLD);
     
     Printer::print("\nAvailable commands:", 0, TextColor::WHITE, TextEmphasis::BOLD_UNDERLINED);
-    std::cout << "\n\n";
+    Printer::write("\n\n");
     Printer::print("`ogy help` - ", 0, TextColor::WHITE, TextEmphasis::BOLD);
     Printer::print("Get info about Ogy and view a summary of the available commands.", 0, TextColor::WHITE, TextEmphasis::NORMAL);
-    std::cout << "\n\n";
+    Printer::write("\n\n");
     Printer::print("`ogy info {file name} (-rec)` - ", 0, TextColor::WHITE, TextEmphasis::BOLD);
     Printer::print("Show info about the specified file.", 0, TextColor::WHITE, TextEmphasis::NORMAL);
-    std::cout << "\n\n";
+    Printer::write("\n\n");
     Printer::print("`ogy ls (-all) (-rec) (-mt)` - ", 0, TextColor::WHITE, TextEmphasis::BOLD);
     Printer::print("List info about items in the current directory. Include the `-all` flag to include hidden items. Include the `-rec` flag to recursively iterate through all subdirectories to get its total size. Include the `-mt` flag to use multithreading.", 0, TextColor::WHITE, TextEmphasis::NORMAL);
-    std::cout << "\n\n";
-    Printer::print("`ogy find {term} (-rec)` - ", 0, TextColor::WHITE, TextEmphasis::BOLD);
-    Printer::print("Find file(s) in the current directory containing the specified term.", 0, TextColor::WHITE, TextEmphasis::NORMAL);
-    std::cout << "\n\n";
+    Printer::write("\n\n");
+    Printer::print("`ogy find {term} (-rec) (-mt) (--index) (--glob | --regex | --fuzzy)` - ", 0, TextColor::WHITE, TextEmphasis::BOLD);
+    Printer::print("Find file(s) in the current directory containing the specified term. Include the `-rec` flag to search subdirectories. Include the `-mt` flag to search subdirectories in parallel. Include the `--index` flag to search the index built with `ogy index build` instead. Include the `--glob` or `--regex` flag to match the term as a glob or regular expression. Include the `--fuzzy` flag to print the paths that best fuzzy match the term, best first.", 0, TextColor::WHITE, TextEmphasis::NORMAL);
+    Printer::write("\n\n");
+    Printer::print("`ogy index build {path}` - ", 0, TextColor::WHITE, TextEmphasis::BOLD);
+    Printer::print("Build or update the file name index of a directory. Only directories that changed since the last build are read again.", 0, TextColor::WHITE, TextEmphasis::NORMAL);
+    Printer::write("\n\n");
     Printer::print("`ogy cd {alias} {path}` - ", 0, TextColor::WHITE, TextEmphasis::BOLD);
     Printer::print("Change directory to an alias' corresponding path. If the alias exists, go to its corresponding path. Otherwise store the path as the alias in the config file and go to the specified path. (Alias is optional, so it could also be used as the built-in cd command)", 0, TextColor::WHITE, TextEmphasis::NORMAL);
     Printer::print("\nIMPORTANT: ", 0, TextColor::YELLOW, TextEmphasis::BOLD);
     Printer::print("The alias cannot contain forward slashes.", 0, TextColor::WHITE, TextEmphasis::NORMAL);
     
-    std::cout << "\n\n";
+    Printer::write("\n\n");
     Printer::print("Author: devran", 0, TextColor::GRAY, TextEmphasis::BOLD);
     Printer::print("\n\n------------------------------", 0, TextColor::WHITE, TextEmphasis::BOLD);
-    std::cout << "\n\n";
+    Printer::write("\n\n");
 }
 
 bool HelpCommand::hasValidArgsAndFlags()
@@ -0,0 +1,88 @@
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <sys/errno.h>
+
+#include "IndexCommand.h"
+#include "../../index/IndexBuilder.h"
+#include "../../printer/Printer.h"
+#include "../../utils/ThreadPool.h"
+
+IndexCommand::IndexCommand(int argc, char** argv)
+    : Command(argc, argv)
+{
+    commandInfo.name = "index";
+    commandInfo.description = "Build or update the file name index of a directory, which `ogy find --index` searches instead of walking the directory.";
+    commandInfo.numArgs = 2;
+    commandInfo.numFlags = 0;
+}
+
+void IndexCommand::execute()
+{
+    build(args.size() > 1 ? args[1] : ".");
+}
+
+void IndexCommand::build(const std::string& root)
+{
+    // The index is stored under the canonical path, so it is found again from any path leading to the directory
+    char resolvedRoot[PATH_MAX];
+    if (realpath(root.c_str(), resolvedRoot) == nullptr)
+    {
+        Printer::write("Error: ", std::strerror(errno), "\n");
+        return;
+    }
+
+    ThreadPool tp(numThreads);
+    IndexBuilder builder(resolvedRoot, tp);
+
+    if (!builder.build())
+    {
+        Printer::write("Error: ", std::strerror(errno), "\n");
+        return;
+    }
+
+    const IndexBuilder::Stats& stats = builder.getStats();
+    FormattedField field;
+
+    Printer::print("Indexed ", 0, TextColor::WHITE, TextEmphasis::BOLD);
+    Printer::print(formatNumber(stats.numEntries, field), 0, TextColor::YELLOW, TextEmphasis::BOLD);
+    Printer::print(" entries in ", 0, TextColor::WHITE, TextEmphasis::BOLD);
+    Printer::print(formatNumber(stats.numDirs, field), 0, TextColor::YELLOW, TextEmphasis::BOLD);
+    Printer::print(" directories of ", 0, TextColor::WHITE, TextEmphasis::BOLD);
+    Printer::print(resolvedRoot, 0, TextColor::CYAN, TextEmphasis::BOLD);
+    Printer::write("\n");
+
+    Printer::print("Read ", 0, TextColor::GRAY, TextEmphasis::NORMAL);
+    Printer::print(formatNumber(stats.numScannedDirs, field), 0, TextColor::GRAY, TextEmphasis::NORMAL);
+    Printer::print(" changed directories", 0, TextColor::GRAY, TextEmphasis::NORMAL);
+    if (stats.numUnreadableDirs > 0)
+    {
+        Printer::print(", skipped ", 0, TextColor::GRAY, TextEmphasis::NORMAL);
+        Printer::print(formatNumber(stats.numUnreadableDirs, field), 0, TextColor::GRAY, TextEmphasis::NORMAL);
+        Printer::print(" unreadable ones", 0, TextColor::GRAY, TextEmphasis::NORMAL);
+    }
+    Printer::write("\n");
+}
+
+bool IndexCommand::hasValidArgsAndFlags()
+{
+    // Set when a global flag is invalid
+    if (!errorMessage.empty()) return false;
+    if (args.empty() || args[0] != "build")
+    {
+        errorMessage = "Unknown 'index' subcommand. Use 'ogy index build {path}' to build the index of a directory.\n";
+        return false;
+    }
+    if (args.size() > commandInfo.numArgs)
+    {
+        errorMessage = "Too many arguments passed to 'index' command. Use 'ogy help' to view the expected arguments.\n";
+        return false;
+    }
+    if (flags.size() > commandInfo.numFlags)
+    {
+        errorMessage = "'index' command doesn't accept any flags.\n";
+        return false;
+    }
+
+    return true;
+}
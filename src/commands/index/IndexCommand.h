@@ -0,0 +1,17 @@
+#pragma once
+
+#include "../Command.h"
+
+class IndexCommand : public Command
+{
+public:
+    IndexCommand(int argc, char** argv);
+    void execute() override;
+    bool hasValidArgsAndFlags() override;
+
+private:
+    /**
+    * Build or update the index of `root`, which is used by `ogy find --index`
+    */
+    void build(const std::string& root);
+};
@@ -1,17 +1,17 @@
 #include <algorithm>
 #include <cstring>
-#include <iostream>
 #include <string>
 #include <sys/errno.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <pwd.h>
 #include <filesystem>
+#include <strings.h>
 
 #include "InfoCommand.h"
 #include "../../printer/Printer.h"
+#include "../../scanner/DirScanner.h"
 
-using DirIterator = std::filesystem::directory_iterator;
-using RecDirIterator = std::filesystem::recursive_directory_iterator;
 using Path = std::filesystem::path;
 
 InfoCommand::InfoCommand(int argc, char** argv)
@@ -25,108 +25,88 @@ InfoCommand::InfoCommand(int argc, char** argv)
 
 void InfoCommand::execute()
 {
-    struct stat fileStat;
+    FileStat fileStat;
     
     // Check if valid file info has been returned
-    if (stat(args[0].c_str(), &fileStat) != 0) 
+    if (!statAt(AT_FDCWD, args[0].c_str(), getStatFields() | STAT_TYPE, fileStat, true)) 
     {
-        std::cout << "File error: " << std::strerror(errno) << "\n";
+        Printer::write("File error: ", std::strerror(errno), "\n");
         return;
     }
 
     // Set file info
-    CommonFileInfo info = setFileInfo(fileStat);
-    
+    std::string fileName;
+    CommonFileInfo info = setFileInfo(fileStat, fileName);
+
+    if (!isTableFormat())
+    {
+        printFileRecord(info, fileName, fileName.empty() ? args[0] : (std::filesystem::current_path() / fileName).string());
+        return;
+    }
+
     // Get the length of the longest string to set the width of each column (to line them up)
-    CommonFileInfoPadding padding = Command::getCommonFileInfoPadding(info);
+    CommonFileInfoPadding padding = Command::getCommonFileInfoPadding(info, fileName);
 
     // Print headers
     Command::printCommonHeaders(padding);
 
     // Print info of each header
-    Command::printCommonFileInfo(info, padding);
+    Command::printCommonFileInfo(info, fileName, padding);
 }
 
-CommonFileInfo InfoCommand::setFileInfo(const struct stat& fileStat)
+CommonFileInfo InfoCommand::setFileInfo(const FileStat& fileStat, std::string& fileName)
 {
     CommonFileInfo info;
-    // Get permissions for the file
-    info.permissions = Command::getPermissions(fileStat);
-    // Get number of hard links to the file
-    info.numLinks = std::to_string(static_cast<int>(fileStat.st_nlink));
-    // Get number of hard links to the file
-    info.owner = getpwuid(fileStat.st_uid)->pw_name ? getpwuid(fileStat.st_uid)->pw_name : "-";
+    info.mode = fileStat.mode;
+    info.numLinks = fileStat.numLinks;
+    info.uid = fileStat.uid;
 
     // Get file name from args
-    std::string fileName;
-    Path filePath;
-
-    for (const auto& entry : DirIterator(std::filesystem::current_path(), std::filesystem::directory_options::skip_permission_denied))
-    {
-        std::string tempFileName = entry.path().filename();
-
-        // Convert file name to all uppercases and lowercases to support uppercase and lowercase user input
-        std::string fileNameUpper = tempFileName;
-        std::transform(fileNameUpper.begin(), fileNameUpper.end(), fileNameUpper.begin(), ::toupper);
-        std::string fileNameLower = tempFileName;
-        std::transform(fileNameLower.begin(), fileNameLower.end(), fileNameLower.begin(), ::tolower);
+    std::string filePath;
 
-        std::string argsUpper = args[0];
-        std::transform(argsUpper.begin(), argsUpper.end(), argsUpper.begin(), ::toupper);
+    Path currentPath = std::filesystem::current_path();
+    DirScanner scanner;
+    DirEntry entry;
 
-        if (tempFileName == args[0] || fileNameLower == args[0] || fileNameUpper == argsUpper)
+    if (scanner.open(currentPath.c_str()))
+    {
+        while (scanner.next(entry))
         {
-            fileName = tempFileName;
-            filePath = entry.path();
+            // Compare the file names case-insensitively to support uppercase and lowercase user input
+            if (entry.name.size() == args[0].size() && strncasecmp(entry.name.data(), args[0].data(), args[0].size()) == 0)
+            {
+                fileName = entry.name;
+                filePath = (currentPath / fileName).string();
+            }
         }
     }
 
-    info.name = fileName;
+    // Paths that aren't a direct child of the current directory are used as given, relative to it
+    if (filePath.empty()) filePath = (currentPath / args[0]).string();
 
     // Get file size in bytes or number of bytes allocated to directory
     off_t totalSize = 0;
-    mode_t perm = fileStat.st_mode;
+    mode_t perm = fileStat.mode;
 
     if (S_ISDIR(perm) && containsFlag("-rec"))
     {
-        auto it = RecDirIterator(filePath, std::filesystem::directory_options::skip_permission_denied);
-        try
-        {
-            for (auto i = std::filesystem::begin(it); i != std::filesystem::end(it); i++)
-            {
-                auto entry = *i;
-                
-                struct stat fileStat;
-
-                // Check if valid file info has been returned
-                if (stat(entry.path().c_str(), &fileStat) != 0)
-                {
-                    break;
-                }
-                totalSize += fileStat.st_size; 
-            }
-        }
-        catch(std::filesystem::filesystem_error& e)
-        {
-            std::cerr << e.what() << '\n';
-        }
-        
+        totalSize = Command::getDirectorySize(AT_FDCWD, filePath.c_str());
     }
     else
     {
-        totalSize = fileStat.st_size;
+        totalSize = fileStat.size;
     }
 
-    info.size = std::to_string(totalSize);
-
-    // Get time and date of last modification
-    info.lastModified = Command::getLastModified(fileStat);
+    info.size = totalSize;
+    info.lastModified = fileStat.lastModified;
 
     return info;
 }
 
 bool InfoCommand::hasValidArgsAndFlags()
 {
+    // Set when a global flag is invalid
+    if (!errorMessage.empty()) return false;
     if (args.size() < commandInfo.numArgs)
     {
         errorMessage = "No arguments passed to 'info' command. Use 'ogy help' to view the expected arguments.\n";
@@ -10,5 +10,8 @@ public:
     bool hasValidArgsAndFlags() override;
 
 private:
-    CommonFileInfo setFileInfo(const struct stat& fileInfo);
+    /**
+    * Get the info of the file. Its name, in the case it has in the directory, is set to `fileName`
+    */
+    CommonFileInfo setFileInfo(const FileStat& fileInfo, std::string& fileName);
 };
@@ -1,22 +1,18 @@
-#include <iostream>
 #include <string>
 #include <sys/errno.h>
+#include <fcntl.h>
 #include <sys/stat.h>
-#include <pwd.h>
 #include <vector>
-#include <thread>
-#include <future>
-#include <mutex>
-#include <iterator>
-#include <list>
+#include <algorithm>
 
 #include "ListCommand.h"
 #include "../info/InfoCommand.h"
 #include "../../printer/Printer.h"
 #include "../../utils/ThreadPool.h"
-
-using DirIterator = std::filesystem::directory_iterator;
-using RecDirIterator = std::filesystem::recursive_directory_iterator;
+#include "../../utils/WaitGroup.h"
+#include "../../scanner/DirScanner.h"
+#include "../../scanner/SizeAggregator.h"
+#include "../../sorter/TopHeap.h"
 
 ListCommand::ListCommand(int argc, char** argv)
     : Command(argc, argv)
@@ -38,127 +34,191 @@ void ListCommand::execute()
 void ListCommand::execute_st()
 {
     Path currentPath = std::filesystem::current_path();
-    bool printHeader = true;
-    
-    std::vector<CommonFileInfo> filesInfo;
+    FileInfoList filesInfo;
 
-    auto it = DirIterator(currentPath, std::filesystem::directory_options::skip_permission_denied);
-    try
-    {
-        CommonFileInfo fileInfo;
+    if (!getFilesInfo_st(currentPath, filesInfo)) return;
 
-        for (auto i = std::filesystem::begin(it); i != std::filesystem::end(it); i++)
-        {
-            auto entry = *i;
+    printFilesInfo(currentPath, filesInfo, nullptr);
+}
 
-            struct stat fileStat;
-            
-            // Check if valid file info has been returned
-            if (stat(entry.path().c_str(), &fileStat) != 0)
-            {
-                std::cout << "Error: " << strerror(errno) << "\n";
-                return;
-            }
-            
-            std::string fileName = entry.path().filename();
-            if (fileName[0] == '.' && !containsFlag("-all")) continue;
+void ListCommand::execute_mt()
+{
+    Path currentPath = std::filesystem::current_path();
+    FileInfoList filesInfo;
+    ThreadPool tp(numThreads);
 
-            Path entryPath = entry.path();            
-            fileInfo = setFileInfo(fileStat, entryPath);
-            filesInfo.emplace_back(fileInfo);
-        }
-    }
-    catch (const std::filesystem::filesystem_error& e)
+    if (!getFilesInfo_mt(currentPath, filesInfo, tp)) return;
+
+    printFilesInfo(currentPath, filesInfo, &tp);
+}
+
+bool ListCommand::getFilesInfo_st(const Path& currentPath, FileInfoList& filesInfo)
+{
+    DirScanner scanner;
+    if (!scanner.open(currentPath.c_str()))
     {
-        std::cerr << e.what() << '\n';
+        Printer::write("Error: ", strerror(scanner.getError()), "\n");
+        return false;
     }
 
-    if (filesInfo.size() < 1) return;
+    const bool includeHidden = containsFlag("-all");
+    const bool recursive = containsFlag("-rec");
+    // The type is always needed to know which entries are directories for `-rec`
+    const unsigned int statFields = getStatFields() | STAT_TYPE;
+    DirEntry entry;
 
-    Printer::print("Current Path: ", 0, TextColor::GRAY, TextEmphasis::BOLD);
-    Printer::print(currentPath.string() + "\n", 0, TextColor::WHITE, TextEmphasis::BOLD);
-
-    CommonFileInfoPadding tempPadding;
-    CommonFileInfoPadding padding = {};
+    // Directories whose total size is computed afterwards for `-rec`
+    std::vector<std::string> dirNames;
+    std::vector<size_t> dirIndices;
 
-    // Get the length of the longest string to set the width of each column (to line them up)
-    for (const auto& info : filesInfo)
+    while (scanner.next(entry))
     {
-        tempPadding = Command::getCommonFileInfoPadding(info);
+        if (entry.name[0] == '.' && !includeHidden) continue;
 
-        if (tempPadding.lastModifiedPadding > padding.lastModifiedPadding) padding.lastModifiedPadding = tempPadding.lastModifiedPadding;
-        if (tempPadding.namePadding > padding.namePadding) padding.namePadding = tempPadding.namePadding;
-        if (tempPadding.numLinksPadding > padding.numLinksPadding) padding.numLinksPadding = tempPadding.numLinksPadding;
-        if (tempPadding.ownerPadding > padding.ownerPadding) padding.ownerPadding = tempPadding.ownerPadding;
-        if (tempPadding.permissionsPadding > padding.permissionsPadding) padding.permissionsPadding = tempPadding.permissionsPadding;
-        if (tempPadding.sizePadding > padding.sizePadding) padding.sizePadding = tempPadding.sizePadding;
-    }
+        FileStat fileStat;
+        
+        // Check if valid file info has been returned
+        if (!statAt(scanner.getFd(), entry.name.data(), statFields, fileStat))
+        {
+            Printer::write("Error: ", strerror(errno), "\n");
+            return false;
+        }
 
-    // Print headers
-    Printer::print(" ", defaultPadding + 2, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
-    Command::printCommonHeaders(padding);
+        if (recursive && S_ISDIR(fileStat.mode))
+        {
+            dirNames.emplace_back(entry.name);
+            dirIndices.emplace_back(filesInfo.files.size());
+        }
 
-    for (size_t i = 0; i < filesInfo.size(); i++)
-    {
-        Printer::print(std::to_string(i + 1), defaultPadding + 2, TextColor::GRAY, TextEmphasis::BOLD);
-        
-        // Print info of each header
-        Command::printCommonFileInfo(filesInfo[i], padding);
+        CommonFileInfo& info = filesInfo.files.emplace_back(setFileInfo(fileStat));
+        filesInfo.setName(info, entry.name);
     }
-}
 
-void ListCommand::execute_mt()
-{
-    Path currentPath = std::filesystem::current_path();
-    bool printHeader = true;
+    setDirectorySizes(scanner.getFd(), dirNames, dirIndices, filesInfo.files, nullptr);
 
-    struct stat dirStat;
+    return true;
+}
 
-    if (stat(currentPath.c_str(), &dirStat) != 0)
+bool ListCommand::getFilesInfo_mt(const Path& currentPath, FileInfoList& filesInfo, ThreadPool& tp)
+{
+    DirScanner scanner;
+    if (!scanner.open(currentPath.c_str()))
     {
-        std::cout << "Error: " << strerror(errno) << "\n";
-        return;
+        Printer::write("Error: ", strerror(scanner.getError()), "\n");
+        return false;
     }
 
-    auto it = DirIterator(currentPath, std::filesystem::directory_options::skip_permission_denied);
-    
-    std::list<std::future<CommonFileInfo>> filesInfoFutures;
-    std::list<CommonFileInfo> filesInfo;
+    const bool includeHidden = containsFlag("-all");
+    const bool recursive = containsFlag("-rec");
+    // The type is always needed to know which entries are directories for `-rec`
+    const unsigned int statFields = getStatFields() | STAT_TYPE;
+    const int dirFd = scanner.getFd();
 
-    try
+    // Read all names into the shared name buffer first, null-terminated, so the entries can be split into batches by position
+    std::string& names = filesInfo.names;
+    std::vector<CommonFileInfo>& files = filesInfo.files;
+    DirEntry entry;
+
+    while (scanner.next(entry))
     {
-        ThreadPool tp;
+        if (entry.name[0] == '.' && !includeHidden) continue;
+
+        filesInfo.setName(files.emplace_back(), entry.name);
+        names += '\0';
+    }
+
+    // Every entry has its own slot, so the workers write their results without any synchronization
+    const size_t numEntries = files.size();
+    std::vector<int> statErrors(numEntries, 0);
 
-        for (auto i = std::filesystem::begin(it); i != std::filesystem::end(it); i++)
+    auto statRange = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
         {
-            auto entry = *i;
-            
-            struct stat fileStat;
-            
-            // Check if valid file info has been returned
-            if (stat(entry.path().c_str(), &fileStat) != 0)
+            const uint32_t nameOffset = files[i].nameOffset;
+            const uint32_t nameLength = files[i].nameLength;
+            FileStat fileStat;
+
+            if (!statAt(dirFd, names.data() + nameOffset, statFields, fileStat))
             {
-                std::cout << "Error: " << strerror(errno) << "\n";
-                return;
+                statErrors[i] = errno;
+                continue;
             }
-            
-            std::string fileName = entry.path().filename();
-            if (fileName[0] == '.' && !containsFlag("-all")) continue;
-            
-            Path entryPath = entry.path();
-            
-            auto fileInfoFuture = tp.addTask([this, fileStat, entryPath]() {return setFileInfo(fileStat, entryPath);});
-            // filesInfoFutures.emplace_back(std::move(fileInfoFuture));
-            CommonFileInfo infoo = fileInfoFuture.get();
-            filesInfo.emplace_back(infoo);
+
+            files[i] = setFileInfo(fileStat);
+            files[i].nameOffset = nameOffset;
+            files[i].nameLength = nameLength;
+        }
+    };
+
+    const size_t numBatches = std::min(numEntries, static_cast<size_t>(tp.getNumThreads()) * 4);
+    WaitGroup pendingBatches(static_cast<int>(numBatches));
+
+    for (size_t batch = 0; batch < numBatches; batch++)
+    {
+        const size_t begin = numEntries * batch / numBatches;
+        const size_t end = numEntries * (batch + 1) / numBatches;
+
+        // Only captures references and the range, so the task is stored inline and submitting it doesn't allocate
+        tp.submit([&statRange, &pendingBatches, begin, end]() {
+            statRange(begin, end);
+            pendingBatches.done();
+        });
+    }
+
+    // Wait for all batches once
+    pendingBatches.wait();
+
+    // Report the first failed entry, like getFilesInfo_st does
+    for (size_t i = 0; i < numEntries; i++)
+    {
+        if (statErrors[i] != 0)
+        {
+            Printer::write("Error: ", strerror(statErrors[i]), "\n");
+            return false;
         }
     }
-    catch (const std::filesystem::filesystem_error& e)
+
+    if (recursive)
     {
-        std::cerr << e.what() << "\n";
+        // Directories whose total size is computed for `-rec`
+        std::vector<std::string> dirNames;
+        std::vector<size_t> dirIndices;
+
+        for (size_t i = 0; i < numEntries; i++)
+        {
+            if (!S_ISDIR(files[i].mode)) continue;
+
+            dirNames.emplace_back(filesInfo.getName(files[i]));
+            dirIndices.emplace_back(i);
+        }
+
+        setDirectorySizes(dirFd, dirNames, dirIndices, files, &tp);
     }
 
-    if (filesInfo.size() < 1) return;
+    return true;
+}
+
+void ListCommand::printFilesInfo(const Path& currentPath, const FileInfoList& filesInfo, ThreadPool* threadPool)
+{
+    if (filesInfo.files.size() < 1) return;
+
+    const std::vector<uint32_t> order = getPrintOrder(filesInfo, threadPool);
+
+    if (!isTableFormat())
+    {
+        std::string path = currentPath.string();
+        if (path.back() != '/') path += '/';
+        const size_t dirPathLength = path.size();
+
+        for (uint32_t i : order)
+        {
+            const CommonFileInfo& info = filesInfo.files[i];
+            path.resize(dirPathLength);
+            path.append(filesInfo.getName(info));
+            printFileRecord(info, filesInfo.getName(info), path);
+        }
+        return;
+    }
 
     Printer::print("Current Path: ", 0, TextColor::GRAY, TextEmphasis::BOLD);
     Printer::print(currentPath.string() + "\n", 0, TextColor::WHITE, TextEmphasis::BOLD);
@@ -167,9 +227,10 @@ void ListCommand::execute_mt()
     CommonFileInfoPadding padding = {};
 
     // Get the length of the longest string to set the width of each column (to line them up)
-    for (const auto& info : filesInfo)
+    for (uint32_t i : order)
     {
-        tempPadding = Command::getCommonFileInfoPadding(info);
+        const CommonFileInfo& info = filesInfo.files[i];
+        tempPadding = Command::getCommonFileInfoPadding(info, filesInfo.getName(info));
 
         if (tempPadding.lastModifiedPadding > padding.lastModifiedPadding) padding.lastModifiedPadding = tempPadding.lastModifiedPadding;
         if (tempPadding.namePadding > padding.namePadding) padding.namePadding = tempPadding.namePadding;
@@ -182,78 +243,96 @@ void ListCommand::execute_mt()
     // Print headers
     Printer::print(" ", defaultPadding + 2, TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED);
     Command::printCommonHeaders(padding);
-    
-    int counter = 0;
-    for (const auto& info : filesInfo)
-    {
-        Printer::print(std::to_string(counter + 1), defaultPadding + 2, TextColor::GRAY, TextEmphasis::BOLD);
-        counter++;
 
+    FormattedField index;
+
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const CommonFileInfo& info = filesInfo.files[order[i]];
+        Printer::print(formatNumber(i + 1, index), defaultPadding + 2, TextColor::GRAY, TextEmphasis::BOLD);
+        
         // Print info of each header
-        Command::printCommonFileInfo(info, padding);
+        Command::printCommonFileInfo(info, filesInfo.getName(info), padding);
     }
 }
 
-CommonFileInfo ListCommand::setFileInfo(const struct stat& fileStat, const Path& entryPath)
+std::vector<uint32_t> ListCommand::getPrintOrder(const FileInfoList& filesInfo, ThreadPool* threadPool) const
 {
-    CommonFileInfo info;
+    const std::vector<CommonFileInfo>& files = filesInfo.files;
+    std::vector<uint32_t> indices;
 
-    // Get permissions for the file
-    info.permissions = Command::getPermissions(fileStat);
-    // Get number of hard links to the file
-    info.numLinks = std::to_string(static_cast<int>(fileStat.st_nlink));
+    if (topCount > 0)
+    {
+        // Only the largest or newest files are kept, so the rest never has to be sorted
+        const SortMode topSortMode = getTopSortMode();
+        TopHeap<uint32_t> top(topCount);
+
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            top.push(FileSorter::getPrimaryKey(topSortMode, files[i].size, files[i].lastModified), static_cast<uint32_t>(i));
+        }
 
-    // Get user name of owner of the file
-    if (passwd* p = getpwuid(fileStat.st_uid))
+        indices = top.take();
+        // Keep ties in the order of the listing
+        std::sort(indices.begin(), indices.end());
+    }
+    else
     {
-        info.owner = p ? getpwuid(fileStat.st_uid)->pw_name : "-";
+        indices.resize(files.size());
+        for (size_t i = 0; i < indices.size(); i++) indices[i] = static_cast<uint32_t>(i);
     }
 
-    // Get file or directory size in bytes
-    off_t totalSize = 0;
-    mode_t perm = fileStat.st_mode;
+    const SortMode printSortMode = getPrintSortMode();
 
-    if (S_ISDIR(perm) && containsFlag("-rec"))
+    if (printSortMode == SortMode::NONE)
     {
-        auto it = RecDirIterator(entryPath, std::filesystem::directory_options::skip_permission_denied);
-        try
-        {
-            for (auto i = std::filesystem::begin(it); i != std::filesystem::end(it); i++)
-            {
-                auto entry = *i;
+        if (reverseSort) std::reverse(indices.begin(), indices.end());
+        return indices;
+    }
 
-                struct stat fileStat;
+    FileSorter sorter(printSortMode, reverseSort);
+    sorter.reserve(indices.size());
 
-                // Check if valid file info has been returned
-                if (stat(entry.path().c_str(), &fileStat) != 0)
-                {
-                    break;
-                }
-                totalSize += fileStat.st_size;
-            }
-        }
-        catch(std::filesystem::filesystem_error& e)
-        {
-            std::cerr << e.what() << '\n';
-        }
-    }
-    else
+    for (uint32_t i : indices) sorter.add(filesInfo.getName(files[i]), files[i].size, files[i].lastModified);
+
+    // The sorter returns positions in `indices`
+    std::vector<uint32_t> order = sorter.sort(threadPool);
+    for (uint32_t& i : order) i = indices[i];
+
+    return order;
+}
+
+void ListCommand::setDirectorySizes(int dirFd, const std::vector<std::string>& dirNames, const std::vector<size_t>& dirIndices, std::vector<CommonFileInfo>& filesInfo, ThreadPool* threadPool)
+{
+    if (dirNames.empty()) return;
+
+    // All subtrees are walked in one pass instead of one walk per directory entry
+    std::vector<off_t> dirSizes = SizeAggregator::aggregate(dirFd, dirNames, threadPool);
+
+    for (size_t i = 0; i < dirSizes.size(); i++)
     {
-        totalSize = fileStat.st_size;
+        filesInfo[dirIndices[i]].size = dirSizes[i];
     }
+}
 
-    info.size = std::to_string(totalSize);
+CommonFileInfo ListCommand::setFileInfo(const FileStat& fileStat)
+{
+    CommonFileInfo info;
 
-    // Get time and date of last modification
-    info.lastModified = Command::getLastModified(fileStat);
-    // Get file name from path
-    info.name = entryPath.filename();
+    info.mode = fileStat.mode;
+    info.numLinks = fileStat.numLinks;
+    info.uid = fileStat.uid;
+    // Get file or directory size in bytes. The total size of directories for `-rec` is set by setDirectorySizes
+    info.size = fileStat.size;
+    info.lastModified = fileStat.lastModified;
 
     return info;
 }
 
 bool ListCommand::hasValidArgsAndFlags()
 {
+    // Set when a global flag is invalid
+    if (!errorMessage.empty()) return false;
     if (args.size() > commandInfo.numArgs)
     {
         errorMessage = "Too many arguments passed to 'ls' command. Use 'ogy help' to view the expected arguments.\n";
@@ -3,9 +3,14 @@
 #include <filesystem>
 #include <iostream>
 #include <sys/stat.h>
+#include <cstdlib>
 #include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "../Command.h"
+#include "../../utils/ThreadPool.h"
 #include <benchmark/benchmark.h>
 
 struct FileInfo;
@@ -21,33 +26,69 @@ public:
     void execute_mt();
     bool hasValidArgsAndFlags() override;
 
-    static void bm_setFileInfo(benchmark::State& state)
+    /**
+    * Benchmarks for collecting the info of the files in the directory set with the OGY_BENCH_DIR environment variable,
+    * e.g. one with 100k entries, to compare execute_st and execute_mt without printing
+    */
+    static void bm_getFilesInfo_st(benchmark::State& state)
     {
-        std::string strCurrentPath = "/Users/devranaydinoglu/Documents/School";
-        Path currentPath = strCurrentPath;
-        struct stat fileStat;
-        
-        if (stat(currentPath.c_str(), &fileStat) != 0)
-        {
-            std::cout << "Error: " << std::strerror(errno) << "\n";
-            return;
-        }
+        runFilesInfoBenchmark(state, false);
+    }
+
+    static void bm_getFilesInfo_mt(benchmark::State& state)
+    {
+        runFilesInfoBenchmark(state, true);
+    }
+
+private:
+    bool getFilesInfo_st(const Path& currentPath, FileInfoList& filesInfo);
+    bool getFilesInfo_mt(const Path& currentPath, FileInfoList& filesInfo, ThreadPool& threadPool);
+
+    /**
+    * Print the files, or only the ones picked with `--top`, in the order selected with `--sort=`. The sort runs on the thread pool if one is passed
+    */
+    void printFilesInfo(const Path& currentPath, const FileInfoList& filesInfo, ThreadPool* threadPool);
+
+    /**
+    * Get the indices of the files in the order they're printed in
+    */
+    std::vector<uint32_t> getPrintOrder(const FileInfoList& filesInfo, ThreadPool* threadPool) const;
+
+    /**
+    * Get the info of a file, without its name
+    */
+    CommonFileInfo setFileInfo(const FileStat& fileInfo);
+
+    /**
+    * Set the total size of the directories at `dirIndices` in `filesInfo` for `-rec`
+    */
+    void setDirectorySizes(int dirFd, const std::vector<std::string>& dirNames, const std::vector<size_t>& dirIndices, std::vector<CommonFileInfo>& filesInfo, ThreadPool* threadPool);
+
+    static void runFilesInfoBenchmark(benchmark::State& state, bool multithreaded)
+    {
+        const char* benchDir = std::getenv("OGY_BENCH_DIR");
+        Path currentPath = benchDir ? benchDir : std::filesystem::current_path().string();
+
+        char arg0[] = "ogy";
+        char arg1[] = "ls";
+        char* argvv[] = {arg0, arg1, nullptr};
+        ListCommand lc(2, argvv);
+
+        FileInfoList filesInfo;
+        ThreadPool tp;
 
-        char** argvv;
-        argvv[0] = const_cast<char*>("ogy");
-        argvv[1] = const_cast<char*>("ls");
-        argvv[2] = const_cast<char*>("-rec");
-        ListCommand lc(3, argvv);
-        
         for (auto _ : state)
         {
-            lc.execute_mt();
+            filesInfo.clear();
+            if (multithreaded) lc.getFilesInfo_mt(currentPath, filesInfo, tp);
+            else lc.getFilesInfo_st(currentPath, filesInfo);
+            benchmark::DoNotOptimize(filesInfo.files.data());
         }
-    }
 
-private:
-    CommonFileInfo setFileInfo(const struct stat& fileInfo, const Path& entryPath);
+        state.SetItemsProcessed(state.iterations() * filesInfo.files.size());
+    }
 };
 
-// Register as benchmark function for Google Benchmark
-// BENCHMARK(ListCommand::bm_setFileInfo);
+// Register as benchmark functions for Google Benchmark
+// BENCHMARK(ListCommand::bm_getFilesInfo_st)->Unit(benchmark::kMillisecond);
+// BENCHMARK(ListCommand::bm_getFilesInfo_mt)->Unit(benchmark::kMillisecond);
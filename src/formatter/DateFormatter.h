@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+
+/**
+* Formats timestamps as local time in the "%a %d %b %Y at %H:%M" format (e.g. "Sat 17 Oct 2026 at 06:43") without localtime/strftime per call.
+* The UTC offset is looked up once per day and cached per thread, as long as it doesn't change during that day (no DST switch),
+* and the date is computed arithmetically and rendered from lookup tables. Thread-safe and allocation-free.
+*/
+class DateFormatter
+{
+public:
+    // Enough for every timestamp, including ones handled by strftime
+    static constexpr size_t bufferSize = 64;
+
+private:
+    static constexpr int64_t secondsPerDay = 86400;
+    static constexpr size_t numCachedDays = 256;
+
+    static constexpr const char* weekdayNames[7] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    static constexpr const char* monthNames[12] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+    /**
+    * UTC offset of local time during one UTC day
+    */
+    struct CachedDay
+    {
+        int64_t day = INT64_MIN;
+        long utcOffset = 0;
+    };
+
+public:
+    /**
+    * Write the local time of `time` to `buffer` (at least `bufferSize` characters) and return the length
+    */
+    static size_t format(time_t time, char* buffer)
+    {
+        long utcOffset;
+        if (!getUtcOffset(time, utcOffset)) return formatWithStrftime(time, buffer);
+
+        const int64_t localTime = static_cast<int64_t>(time) + utcOffset;
+        const int64_t days = floorDiv(localTime, secondsPerDay);
+        const int64_t secondsOfDay = localTime - days * secondsPerDay;
+
+        int64_t year;
+        unsigned int month;
+        unsigned int day;
+        civilFromDays(days, year, month, day);
+
+        // Years without exactly 4 digits are rare enough to leave them to strftime
+        if (year < 1000 || year > 9999) return formatWithStrftime(time, buffer);
+
+        // 1970-01-01 was a Thursday
+        const int64_t weekday = ((days % 7) + 11) % 7;
+        const unsigned int hour = static_cast<unsigned int>(secondsOfDay / 3600);
+        const unsigned int minute = static_cast<unsigned int>(secondsOfDay % 3600 / 60);
+
+        char* out = buffer;
+        out = appendName(out, weekdayNames[weekday]);
+        *out++ = ' ';
+        out = appendTwoDigits(out, day);
+        *out++ = ' ';
+        out = appendName(out, monthNames[month - 1]);
+        *out++ = ' ';
+        out = appendTwoDigits(out, static_cast<unsigned int>(year / 100));
+        out = appendTwoDigits(out, static_cast<unsigned int>(year % 100));
+        *out++ = ' ';
+        *out++ = 'a';
+        *out++ = 't';
+        *out++ = ' ';
+        out = appendTwoDigits(out, hour);
+        *out++ = ':';
+        out = appendTwoDigits(out, minute);
+
+        return out - buffer;
+    }
+
+private:
+    /**
+    * Get the UTC offset for `time` from the cache, or look it up and cache it for the whole UTC day if it is the same at both ends of the day.
+    * Returns false if the time can't be converted
+    */
+    static bool getUtcOffset(time_t time, long& utcOffset)
+    {
+        static std::once_flag tzLoaded;
+        std::call_once(tzLoaded, []() {tzset();});
+
+        thread_local CachedDay cachedDays[numCachedDays];
+
+        const int64_t day = floorDiv(static_cast<int64_t>(time), secondsPerDay);
+        CachedDay& cached = cachedDays[static_cast<uint64_t>(day) % numCachedDays];
+
+        if (cached.day == day)
+        {
+            utcOffset = cached.utcOffset;
+            return true;
+        }
+
+        std::tm localTime;
+        if (localtime_r(&time, &localTime) == nullptr) return false;
+        utcOffset = localTime.tm_gmtoff;
+
+        // The offset might change during the day (DST switch), in which case the day can't be cached
+        const time_t dayStart = static_cast<time_t>(day * secondsPerDay);
+        const time_t dayEnd = static_cast<time_t>(dayStart + secondsPerDay - 1);
+        std::tm startTime;
+        std::tm endTime;
+
+        if (localtime_r(&dayStart, &startTime) != nullptr && localtime_r(&dayEnd, &endTime) != nullptr
+            && startTime.tm_gmtoff == utcOffset && endTime.tm_gmtoff == utcOffset)
+        {
+            cached.day = day;
+            cached.utcOffset = utcOffset;
+        }
+
+        return true;
+    }
+
+    static size_t formatWithStrftime(time_t time, char* buffer)
+    {
+        std::tm localTime;
+        if (localtime_r(&time, &localTime) == nullptr) return 0;
+
+        return std::strftime(buffer, bufferSize, "%a %d %b %Y at %H:%M", &localTime);
+    }
+
+    /**
+    * Convert days since 1970-01-01 to a date in the proleptic Gregorian calendar (Howard Hinnant's civil_from_days)
+    */
+    static void civilFromDays(int64_t days, int64_t& year, unsigned int& month, unsigned int& day)
+    {
+        days += 719468;
+        const int64_t era = floorDiv(days, 146097);
+        const unsigned int dayOfEra = static_cast<unsigned int>(days - era * 146097);
+        const unsigned int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        const unsigned int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        // Months starting in March, so the leap day is at the end of the year
+        const unsigned int shiftedMonth = (5 * dayOfYear + 2) / 153;
+
+        day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+        month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+        year = static_cast<int64_t>(yearOfEra) + era * 400 + (month <= 2 ? 1 : 0);
+    }
+
+    static int64_t floorDiv(int64_t a, int64_t b)
+    {
+        return a / b - (a % b < 0 ? 1 : 0);
+    }
+
+    static char* appendName(char* out, const char* name)
+    {
+        out[0] = name[0];
+        out[1] = name[1];
+        out[2] = name[2];
+        return out + 3;
+    }
+
+    static char* appendTwoDigits(char* out, unsigned int value)
+    {
+        static constexpr char digits[] =
+            "00010203040506070809"
+            "10111213141516171819"
+            "20212223242526272829"
+            "30313233343536373839"
+            "40414243444546474849"
+            "50515253545556575859"
+            "60616263646566676869"
+            "70717273747576777879"
+            "80818283848586878889"
+            "90919293949596979899";
+
+        out[0] = digits[value * 2];
+        out[1] = digits[value * 2 + 1];
+        return out + 2;
+    }
+};
@@ -1,7 +1,8 @@
 #pragma once
 
-#include <map>
-#include <string>
+#include <array>
+#include <cstddef>
+#include <string_view>
 
 enum class TextColor
 {
@@ -22,24 +23,82 @@ enum class TextEmphasis
     BOLD_UNDERLINED
 };
 
+/**
+* ANSI escape sequences for every combination of TextColor and TextEmphasis, built at compile time
+*/
 class Formatter
 {
 public:
-    inline static std::map<TextColor, std::string> colorsToStringMapping = {
-        {TextColor::GREEN, "32"},
-        {TextColor::YELLOW, "33"},
-        {TextColor::MAGENTA, "35"},
-        {TextColor::CYAN, "36"},
-        {TextColor::GRAY, "90"},
-        {TextColor::WHITE, "37"}
-    };
+    static constexpr size_t numColors = 6;
+    static constexpr size_t numEmphases = 5;
+
+    static constexpr std::string_view reset = "\033[0m";
 
-    inline static std::map<TextEmphasis, std::string> emphasesToStringMapping = {
-        {TextEmphasis::NORMAL, "0"},
-        {TextEmphasis::BOLD, "1"},
-        {TextEmphasis::ITALIC, "3"},
-        {TextEmphasis::UNDERLINED, "4"},
-        {TextEmphasis::BOLD_UNDERLINED, "1;4"}
+private:
+    // Indexed by the enum values
+    static constexpr std::string_view colorCodes[numColors] = {"32", "33", "35", "36", "90", "37"};
+    static constexpr std::string_view emphasisCodes[numEmphases] = {"0", "1", "3", "4", "1;4"};
 
+    struct Style
+    {
+        char sequence[16] = {};
+        size_t length = 0;
+
+        constexpr void append(std::string_view str)
+        {
+            for (char c : str) sequence[length++] = c;
+        }
     };
-};
\ No newline at end of file
+
+    using StyleTable = std::array<std::array<Style, numColors>, numEmphases>;
+
+    static constexpr StyleTable makeStyles()
+    {
+        StyleTable table{};
+
+        for (size_t emphasis = 0; emphasis < numEmphases; emphasis++)
+        {
+            for (size_t color = 0; color < numColors; color++)
+            {
+                // e.g. "\033[0;1;32m" for bold green. Every sequence starts with a reset, so switching from one style
+                // to another doesn't need a separate reset and no attribute (e.g. underlining) carries over
+                Style& style = table[emphasis][color];
+                style.append("\033[");
+                if (emphasisCodes[emphasis] != "0") style.append("0;");
+                style.append(emphasisCodes[emphasis]);
+                style.append(";");
+                style.append(colorCodes[color]);
+                style.append("m");
+            }
+        }
+
+        return table;
+    }
+
+    // Defined below the class, since makeStyles can't be evaluated before the class is complete
+    static const StyleTable styles;
+
+public:
+    /**
+    * Complete escape sequence which switches to the style
+    */
+    static constexpr std::string_view getStyle(TextColor textColor, TextEmphasis textEmphasis)
+    {
+        const Style& style = styles[static_cast<size_t>(textEmphasis)][static_cast<size_t>(textColor)];
+        return std::string_view(style.sequence, style.length);
+    }
+
+    /**
+    * Unique index of the style, e.g. to check whether it changed
+    */
+    static constexpr int getStyleIndex(TextColor textColor, TextEmphasis textEmphasis)
+    {
+        return static_cast<int>(static_cast<size_t>(textEmphasis) * numColors + static_cast<size_t>(textColor));
+    }
+};
+
+inline constexpr Formatter::StyleTable Formatter::styles = Formatter::makeStyles();
+
+static_assert(Formatter::getStyle(TextColor::GREEN, TextEmphasis::BOLD) == "\033[0;1;32m");
+static_assert(Formatter::getStyle(TextColor::GRAY, TextEmphasis::BOLD_UNDERLINED) == "\033[0;1;4;90m");
+static_assert(Formatter::getStyle(TextColor::WHITE, TextEmphasis::NORMAL) == "\033[0;37m");
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/**
+* Renders a file mode like "d rwx r-x r-x" from lookup tables built at compile time.
+* The first character is the file type (`-` file, `d` directory, `l` symlink, `s` socket, `p` fifo, `c`/`b` character/block device),
+* followed by the owner, group and other permissions. Setuid and setgid show as `s` in the owner/group execute position
+* and the sticky bit as `t` in the other execute position (uppercase if the execute bit itself isn't set), like ls does.
+*/
+class PermissionFormatter
+{
+public:
+    // Type, space and three groups of three permissions separated by spaces
+    static constexpr size_t length = 13;
+
+private:
+    // Indexed by the 12 permission bits (setuid, setgid, sticky and rwx for owner, group and other)
+    static constexpr size_t numPermissionModes = 1 << 12;
+    using Permissions = std::array<char, length - 2>;
+    using PermissionTable = std::array<Permissions, numPermissionModes>;
+
+    static constexpr PermissionTable makePermissions()
+    {
+        PermissionTable table{};
+
+        for (size_t mode = 0; mode < numPermissionModes; mode++)
+        {
+            Permissions& perms = table[mode];
+
+            perms[0] = (mode & S_IRUSR) ? 'r' : '-';
+            perms[1] = (mode & S_IWUSR) ? 'w' : '-';
+            perms[2] = executeChar(mode & S_IXUSR, mode & S_ISUID, 's');
+            perms[3] = ' ';
+            perms[4] = (mode & S_IRGRP) ? 'r' : '-';
+            perms[5] = (mode & S_IWGRP) ? 'w' : '-';
+            perms[6] = executeChar(mode & S_IXGRP, mode & S_ISGID, 's');
+            perms[7] = ' ';
+            perms[8] = (mode & S_IROTH) ? 'r' : '-';
+            perms[9] = (mode & S_IWOTH) ? 'w' : '-';
+            perms[10] = executeChar(mode & S_IXOTH, mode & S_ISVTX, 't');
+        }
+
+        return table;
+    }
+
+    static constexpr char executeChar(bool execute, bool special, char specialChar)
+    {
+        if (special) return execute ? specialChar : static_cast<char>(specialChar - 'a' + 'A');
+        return execute ? 'x' : '-';
+    }
+
+    // Indexed by the file type bits of the mode (S_IFMT), shifted down
+    static constexpr std::array<char, 16> makeTypes()
+    {
+        std::array<char, 16> types{};
+        for (char& type : types) type = '?';
+
+        types[S_IFREG >> 12] = '-';
+        types[S_IFDIR >> 12] = 'd';
+        types[S_IFLNK >> 12] = 'l';
+        types[S_IFSOCK >> 12] = 's';
+        types[S_IFIFO >> 12] = 'p';
+        types[S_IFCHR >> 12] = 'c';
+        types[S_IFBLK >> 12] = 'b';
+
+        return types;
+    }
+
+    // Defined below the class, since the make functions can't be evaluated before the class is complete
+    static const PermissionTable permissions;
+    static const std::array<char, 16> types;
+
+public:
+    /**
+    * Write the mode to `out` (at least `length` characters) and return the length
+    */
+    static size_t format(mode_t mode, char* out)
+    {
+        out[0] = types[(mode & S_IFMT) >> 12];
+        out[1] = ' ';
+
+        const Permissions& perms = permissions[mode & (numPermissionModes - 1)];
+        for (size_t i = 0; i < perms.size(); i++) out[i + 2] = perms[i];
+
+        return length;
+    }
+};
+
+inline constexpr PermissionFormatter::PermissionTable PermissionFormatter::permissions = PermissionFormatter::makePermissions();
+inline constexpr std::array<char, 16> PermissionFormatter::types = PermissionFormatter::makeTypes();
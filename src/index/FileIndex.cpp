@@ -0,0 +1,400 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <pwd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FileIndex.h"
+
+FileIndex::~FileIndex()
+{
+    close();
+}
+
+bool FileIndex::open(const std::string& path)
+{
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || static_cast<size_t>(fileStat.st_size) < sizeof(Header))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* mapped = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (mapped == MAP_FAILED) return false;
+
+    data = static_cast<const char*>(mapped);
+    size = fileStat.st_size;
+    header = reinterpret_cast<const Header*>(data);
+
+    if (!isValid())
+    {
+        close();
+        return false;
+    }
+
+    dirs = reinterpret_cast<const Dir*>(data + header->dirsOffset);
+    entries = reinterpret_cast<const Entry*>(data + header->entriesOffset);
+    blockOffsets = reinterpret_cast<const uint64_t*>(data + header->blockOffsetsOffset);
+    names = reinterpret_cast<const unsigned char*>(data + header->namesOffset);
+    namesEnd = names + header->namesSize;
+    trigrams = reinterpret_cast<const Trigram*>(data + header->trigramsOffset);
+    postings = reinterpret_cast<const unsigned char*>(data + header->postingsOffset);
+
+    if (!hasValidContents())
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void FileIndex::close()
+{
+    if (data != nullptr) munmap(const_cast<char*>(data), size);
+
+    data = nullptr;
+    size = 0;
+    header = nullptr;
+}
+
+bool FileIndex::isValid() const
+{
+    if (std::memcmp(header->magic, magic, sizeof(magic)) != 0 || header->version != version) return false;
+    // A file that was cut short, e.g. by a full disk
+    if (header->fileSize != size) return false;
+
+    const uint64_t numBlocks = (header->numEntries + entriesPerBlock - 1) / entriesPerBlock;
+
+    auto fits = [this](uint64_t offset, uint64_t length) {return offset <= size && length <= size - offset;};
+    // The sections of structs are read in place, so they have to be aligned like the IndexBuilder writes them
+    const bool aligned = header->dirsOffset % alignof(Dir) == 0 && header->entriesOffset % alignof(Entry) == 0
+        && header->blockOffsetsOffset % alignof(uint64_t) == 0 && header->trigramsOffset % alignof(Trigram) == 0;
+
+    return aligned
+        && header->numDirs > 0
+        && header->numDirs < noDir && header->numEntries < UINT32_MAX
+        && fits(header->rootOffset, header->rootLength)
+        && fits(header->dirsOffset, header->numDirs * sizeof(Dir))
+        && fits(header->entriesOffset, header->numEntries * sizeof(Entry))
+        && fits(header->blockOffsetsOffset, (numBlocks + 1) * sizeof(uint64_t))
+        && fits(header->namesOffset, header->namesSize)
+        && fits(header->trigramsOffset, header->numTrigrams * sizeof(Trigram))
+        && fits(header->postingsOffset, header->postingsSize);
+}
+
+bool FileIndex::hasValidContents() const
+{
+    const uint64_t numDirs = header->numDirs;
+    const uint64_t numEntries = header->numEntries;
+
+    // Directories are numbered in pre-order and their entries are stored one directory after another
+    uint64_t nextEntry = 0;
+
+    for (uint64_t dir = 0; dir < numDirs; dir++)
+    {
+        const Dir& d = dirs[dir];
+
+        if (d.firstEntry != nextEntry || d.numEntries > numEntries - nextEntry) return false;
+        nextEntry += d.numEntries;
+
+        if (d.subtreeEnd <= dir || d.subtreeEnd > numDirs) return false;
+
+        if (dir == 0)
+        {
+            if (d.parent != noDir || d.nameEntry != noDir) return false;
+            continue;
+        }
+
+        if (d.parent >= dir || d.subtreeEnd > dirs[d.parent].subtreeEnd) return false;
+        if (d.nameEntry < dirs[d.parent].firstEntry || d.nameEntry >= dirs[d.parent].firstEntry + dirs[d.parent].numEntries) return false;
+        if (entries[d.nameEntry].childDir != dir) return false;
+    }
+
+    if (nextEntry != numEntries) return false;
+
+    for (uint64_t entry = 0; entry < numEntries; entry++)
+    {
+        const uint32_t childDir = entries[entry].childDir;
+        if (childDir != noDir && (childDir == 0 || childDir >= numDirs || dirs[childDir].nameEntry != entry)) return false;
+    }
+
+    // Every block has to decode to its names and end where the next one starts
+    const uint64_t numBlocks = (numEntries + entriesPerBlock - 1) / entriesPerBlock;
+    std::string name;
+
+    for (uint64_t block = 0; block < numBlocks; block++)
+    {
+        if (blockOffsets[block] > blockOffsets[block + 1] || blockOffsets[block + 1] > header->namesSize) return false;
+
+        const unsigned char* in = names + blockOffsets[block];
+        const unsigned char* end = names + blockOffsets[block + 1];
+        const uint64_t blockEntries = std::min<uint64_t>(entriesPerBlock, numEntries - block * entriesPerBlock);
+
+        name.clear();
+        for (uint64_t i = 0; i < blockEntries && in != nullptr; i++) in = decodeName(in, end, name);
+
+        if (in != end) return false;
+    }
+
+    // Posting lists are stored in the order of their keys, one after another, with ascending entries
+    const unsigned char* in = postings;
+    const unsigned char* postingsEnd = postings + header->postingsSize;
+
+    for (uint64_t t = 0; t < header->numTrigrams; t++)
+    {
+        const Trigram& trigram = trigrams[t];
+        if ((t > 0 && trigram.key <= trigrams[t - 1].key) || trigram.postingsOffset != static_cast<uint64_t>(in - postings)) return false;
+
+        uint64_t entry = 0;
+
+        for (uint32_t i = 0; i < trigram.numEntries; i++)
+        {
+            uint64_t delta;
+            in = Varint::read(in, postingsEnd, delta);
+            if (in == nullptr || (i > 0 && delta == 0) || delta >= numEntries - entry) return false;
+            entry += delta;
+        }
+    }
+
+    return in == postingsEnd;
+}
+
+void FileIndex::getName(uint32_t entry, std::string& name) const
+{
+    const uint32_t blockStart = static_cast<uint32_t>(entry / entriesPerBlock * entriesPerBlock);
+    const unsigned char* in = names + blockOffsets[entry / entriesPerBlock];
+
+    name.clear();
+    for (uint32_t i = blockStart; i <= entry; i++) in = decodeName(in, namesEnd, name);
+}
+
+uint32_t FileIndex::findDir(std::string_view relativePath) const
+{
+    uint32_t dir = 0;
+    std::string name;
+
+    while (!relativePath.empty())
+    {
+        const size_t end = relativePath.find('/');
+        const std::string_view component = relativePath.substr(0, end);
+        relativePath = end == std::string_view::npos ? std::string_view() : relativePath.substr(end + 1);
+
+        if (component.empty()) continue;
+
+        // The entries of a directory are sorted by name
+        uint32_t low = dirs[dir].firstEntry;
+        uint32_t high = low + dirs[dir].numEntries;
+
+        while (low < high)
+        {
+            const uint32_t middle = low + (high - low) / 2;
+            getName(middle, name);
+
+            if (std::string_view(name) < component) low = middle + 1;
+            else high = middle;
+        }
+
+        if (low == dirs[dir].firstEntry + dirs[dir].numEntries) return noDir;
+
+        getName(low, name);
+        if (std::string_view(name) != component || entries[low].childDir == noDir) return noDir;
+
+        dir = entries[low].childDir;
+    }
+
+    return dir;
+}
+
+std::string FileIndex::getDirPath(uint32_t dir) const
+{
+    std::string path;
+    std::string name;
+
+    for (; dirs[dir].parent != noDir; dir = dirs[dir].parent)
+    {
+        getName(dirs[dir].nameEntry, name);
+        // Built back to front, so the components are inserted at the start
+        path.insert(0, name);
+        if (dirs[dirs[dir].parent].parent != noDir) path.insert(0, 1, '/');
+    }
+
+    return path;
+}
+
+uint32_t FileIndex::getEntryDir(uint32_t entry) const
+{
+    // The last directory starting at or before the entry. Directories without entries start at the same entry as the next one
+    uint32_t low = 0;
+    uint32_t high = getNumDirs();
+
+    while (high - low > 1)
+    {
+        const uint32_t middle = low + (high - low) / 2;
+
+        if (dirs[middle].firstEntry <= entry) low = middle;
+        else high = middle;
+    }
+
+    return low;
+}
+
+const FileIndex::Trigram* FileIndex::findTrigram(uint32_t key) const
+{
+    const Trigram* end = trigrams + header->numTrigrams;
+    const Trigram* trigram = std::lower_bound(trigrams, end, key, [](const Trigram& t, uint32_t k) {return t.key < k;});
+
+    return (trigram != end && trigram->key == key) ? trigram : nullptr;
+}
+
+bool FileIndex::findCandidates(std::string_view lowercaseTerm, uint32_t firstEntry, uint32_t lastEntry, std::vector<uint32_t>& candidates) const
+{
+    candidates.clear();
+    if (lowercaseTerm.size() < trigramLength) return false;
+
+    std::vector<const Trigram*> termTrigrams;
+
+    for (size_t i = 0; i + trigramLength <= lowercaseTerm.size(); i++)
+    {
+        const Trigram* trigram = findTrigram(getTrigramKey(lowercaseTerm.data() + i));
+        // No name has the trigram, so only the non-ASCII names can contain the term
+        if (trigram == nullptr)
+        {
+            termTrigrams.clear();
+            break;
+        }
+
+        termTrigrams.emplace_back(trigram);
+    }
+
+    if (!termTrigrams.empty())
+    {
+        // Start with the shortest list, so the candidates only get fewer from there
+        // A term can have the same trigram several times, which has to be checked only once
+        std::sort(termTrigrams.begin(), termTrigrams.end(), [](const Trigram* a, const Trigram* b) {
+            return a->numEntries != b->numEntries ? a->numEntries < b->numEntries : a < b;
+        });
+        termTrigrams.erase(std::unique(termTrigrams.begin(), termTrigrams.end()), termTrigrams.end());
+
+        decodePostings(*termTrigrams[0], firstEntry, lastEntry, candidates);
+
+        for (size_t t = 1; t < termTrigrams.size() && !candidates.empty(); t++)
+        {
+            const unsigned char* in = postings + termTrigrams[t]->postingsOffset;
+            uint64_t entry = 0;
+            size_t kept = 0;
+            size_t candidate = 0;
+
+            // Both are ascending, so one pass over the list keeps the candidates in it. It stops after the last candidate
+            for (uint32_t i = 0; i < termTrigrams[t]->numEntries && candidate < candidates.size(); i++)
+            {
+                uint64_t delta;
+                in = Varint::read(in, delta);
+                entry += delta;
+
+                while (candidate < candidates.size() && candidates[candidate] < entry) candidate++;
+                if (candidate < candidates.size() && candidates[candidate] == entry) candidates[kept++] = candidates[candidate++];
+            }
+
+            candidates.resize(kept);
+        }
+    }
+
+    const Trigram* nonAscii = findTrigram(nonAsciiKey);
+    if (nonAscii != nullptr)
+    {
+        std::vector<uint32_t> nonAsciiEntries;
+        decodePostings(*nonAscii, firstEntry, lastEntry, nonAsciiEntries);
+
+        // Non-ASCII names can be in both lists
+        std::vector<uint32_t> merged;
+        merged.reserve(candidates.size() + nonAsciiEntries.size());
+        std::set_union(candidates.begin(), candidates.end(), nonAsciiEntries.begin(), nonAsciiEntries.end(), std::back_inserter(merged));
+        candidates.swap(merged);
+    }
+
+    return true;
+}
+
+void FileIndex::decodePostings(const Trigram& trigram, uint32_t firstEntry, uint32_t lastEntry, std::vector<uint32_t>& out) const
+{
+    const unsigned char* in = postings + trigram.postingsOffset;
+    uint64_t entry = 0;
+
+    for (uint32_t i = 0; i < trigram.numEntries; i++)
+    {
+        uint64_t delta;
+        in = Varint::read(in, delta);
+        entry += delta;
+
+        if (entry >= lastEntry) break;
+        if (entry >= firstEntry) out.emplace_back(static_cast<uint32_t>(entry));
+    }
+}
+
+std::string FileIndex::getIndexDirectory()
+{
+    const char* home = std::getenv("HOME");
+    if (home == nullptr || home[0] == '\0')
+    {
+        struct passwd* user = getpwuid(getuid());
+        home = user ? user->pw_dir : "";
+    }
+
+    return std::string(home) + "/.local/bin/ogy/indexes";
+}
+
+std::string FileIndex::getIndexPath(std::string_view root)
+{
+    // FNV-1a, which is enough to tell the indexed directories of a user apart
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : root)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+
+    static constexpr char digits[] = "0123456789abcdef";
+    char hex[16];
+    for (int i = 15; i >= 0; i--, hash >>= 4) hex[i] = digits[hash & 0xf];
+
+    return getIndexDirectory() + "/" + std::string(hex, sizeof(hex)) + ".idx";
+}
+
+bool FileIndex::openFor(std::string_view path, std::string& relativePath)
+{
+    std::string_view root = path;
+
+    while (true)
+    {
+        // Different paths can have the same hash, so the stored root has to match as well
+        if (open(getIndexPath(root)) && getRoot() == root)
+        {
+            relativePath.assign(path.substr(root.size()));
+            if (!relativePath.empty() && relativePath[0] == '/') relativePath.erase(0, 1);
+
+            return true;
+        }
+
+        if (root == "/" || root.empty()) break;
+
+        const size_t slash = root.rfind('/');
+        if (slash == std::string_view::npos) break;
+        root = slash == 0 ? std::string_view("/") : root.substr(0, slash);
+    }
+
+    close();
+    return false;
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../utils/Varint.h"
+
+/**
+* Read-only view of a file name index written by IndexBuilder, memory-mapped so opening it doesn't read the whole file.
+*
+* The index stores the directory tree below its root. Directories are numbered in pre-order with their children sorted by name,
+* so every subtree is a contiguous range of directories, and the entries of all directories are stored one directory after another,
+* each directory's entries sorted by name. Entry names are front-coded in blocks of `entriesPerBlock` names: every name is stored as
+* the length of the prefix it shares with the previous name plus the remaining bytes, and the first name of a block is stored whole,
+* so any name can be decoded from the start of its block. Directories also keep their modification time, which lets the next build
+* reuse the entries of directories that didn't change.
+*
+* For substring searches the index also has a posting list for every trigram (3 consecutive bytes) of the lowercased names:
+* the ascending numbers of the entries whose name contains it, stored as LEB128 deltas. A term of 3 or more bytes can only be
+* in names which contain all of its trigrams, so intersecting their lists leaves a few candidates to check instead of every name.
+* Names with non-ASCII bytes are case folded per character when searching, which can turn them into trigrams they don't have,
+* so they are also listed under `nonAsciiKey` and are always candidates
+*/
+class FileIndex
+{
+public:
+    static constexpr char magic[8] = {'O', 'G', 'Y', 'I', 'D', 'X', '\0', '\0'};
+    static constexpr uint32_t version = 3;
+    static constexpr size_t entriesPerBlock = 16;
+    static constexpr uint32_t noDir = UINT32_MAX;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t fileSize;
+        uint64_t rootOffset;
+        uint64_t rootLength;
+        uint64_t numDirs;
+        uint64_t dirsOffset;
+        uint64_t numEntries;
+        uint64_t entriesOffset;
+        // One offset into the names per block, plus one for the end of the names
+        uint64_t blockOffsetsOffset;
+        uint64_t namesOffset;
+        uint64_t namesSize;
+        // Sorted by key
+        uint64_t numTrigrams;
+        uint64_t trigramsOffset;
+        uint64_t postingsOffset;
+        uint64_t postingsSize;
+    };
+
+    struct Dir
+    {
+        int64_t mtimeSec;
+        uint32_t mtimeNsec;
+        uint32_t parent; // noDir for the root
+        uint32_t nameEntry; // Entry of the directory in its parent, noDir for the root
+        uint32_t subtreeEnd; // One past the last directory below this one
+        uint32_t firstEntry;
+        uint32_t numEntries;
+    };
+
+    struct Entry
+    {
+        uint32_t childDir; // Directory of the entry if it is one and could be read, otherwise noDir
+        uint8_t type; // DT_* value
+        uint8_t padding[3];
+    };
+
+    struct Trigram
+    {
+        uint32_t key; // The 3 bytes, first byte highest
+        uint32_t numEntries;
+        uint64_t postingsOffset;
+    };
+
+    static constexpr size_t trigramLength = 3;
+    // Above every 3 byte key, so its list comes last
+    static constexpr uint32_t nonAsciiKey = 1u << 24;
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+    const Header* header = nullptr;
+    const Dir* dirs = nullptr;
+    const Entry* entries = nullptr;
+    const uint64_t* blockOffsets = nullptr;
+    const unsigned char* names = nullptr;
+    const unsigned char* namesEnd = nullptr;
+    const Trigram* trigrams = nullptr;
+    const unsigned char* postings = nullptr;
+
+public:
+    FileIndex() = default;
+    ~FileIndex();
+
+    FileIndex(const FileIndex&) = delete;
+    FileIndex& operator=(const FileIndex&) = delete;
+
+    /**
+    * Map the index file at `path`. Returns false if it doesn't exist or isn't a valid index of this version.
+    * Everything later read from the index is checked here, so a damaged index is rejected instead of read out of bounds
+    */
+    bool open(const std::string& path);
+
+    void close();
+
+    [[nodiscard]] bool isOpen() const { return data != nullptr; }
+
+    /**
+    * Absolute path of the indexed directory
+    */
+    [[nodiscard]] std::string_view getRoot() const
+    {
+        return std::string_view(data + header->rootOffset, header->rootLength);
+    }
+
+    [[nodiscard]] uint32_t getNumDirs() const { return static_cast<uint32_t>(header->numDirs); }
+    [[nodiscard]] uint32_t getNumEntries() const { return static_cast<uint32_t>(header->numEntries); }
+    [[nodiscard]] const Dir& getDir(uint32_t dir) const { return dirs[dir]; }
+    [[nodiscard]] const Entry& getEntry(uint32_t entry) const { return entries[entry]; }
+
+    /**
+    * Decode the name of a single entry into `name`
+    */
+    void getName(uint32_t entry, std::string& name) const;
+
+    /**
+    * Get the directory at `relativePath` ("" for the root, components separated by '/'), or noDir if it isn't in the index
+    */
+    [[nodiscard]] uint32_t findDir(std::string_view relativePath) const;
+
+    /**
+    * Get the path of a directory relative to the root, "" for the root itself
+    */
+    [[nodiscard]] std::string getDirPath(uint32_t dir) const;
+
+    /**
+    * Call `visitor(uint32_t dir, uint32_t entry, std::string_view name)` for every entry of the directories `firstDir` to `lastDir` (exclusive).
+    * The names are decoded sequentially into one buffer, so visiting doesn't allocate per entry. The name is only valid during the call
+    */
+    template<typename Visitor>
+    void forEachEntry(uint32_t firstDir, uint32_t lastDir, Visitor&& visitor) const
+    {
+        if (firstDir >= lastDir) return;
+
+        const uint32_t firstEntry = dirs[firstDir].firstEntry;
+        const uint32_t lastEntry = dirs[lastDir - 1].firstEntry + dirs[lastDir - 1].numEntries;
+        if (firstEntry >= lastEntry) return;
+
+        std::string name;
+        const unsigned char* in = names + blockOffsets[firstEntry / entriesPerBlock];
+
+        // Decode the names before the first entry in its block, since every name depends on the previous one
+        for (uint32_t entry = static_cast<uint32_t>(firstEntry / entriesPerBlock * entriesPerBlock); entry < firstEntry; entry++)
+        {
+            in = decodeName(in, namesEnd, name);
+        }
+
+        uint32_t dir = firstDir;
+
+        for (uint32_t entry = firstEntry; entry < lastEntry; entry++)
+        {
+            if (entry % entriesPerBlock == 0) name.clear();
+            in = decodeName(in, namesEnd, name);
+
+            while (entry >= dirs[dir].firstEntry + dirs[dir].numEntries) dir++;
+            visitor(dir, entry, std::string_view(name));
+        }
+    }
+
+    /**
+    * Get the directory containing the entry
+    */
+    [[nodiscard]] uint32_t getEntryDir(uint32_t entry) const;
+
+    /**
+    * Get the entries from `firstEntry` to `lastEntry` (exclusive) whose lowercased names contain all trigrams of `lowercaseTerm`
+    * or have non-ASCII bytes, in ascending order. Every name containing the term is a candidate, but the candidates still have to be checked.
+    * `lowercaseTerm` has to be ASCII. Returns false if the term is shorter than a trigram
+    */
+    bool findCandidates(std::string_view lowercaseTerm, uint32_t firstEntry, uint32_t lastEntry, std::vector<uint32_t>& candidates) const;
+
+    /**
+    * Key of the trigram starting at `bytes`, lowercased like `tolower` in the C locale
+    */
+    static uint32_t getTrigramKey(const char* bytes)
+    {
+        return (static_cast<uint32_t>(toLower(bytes[0])) << 16) | (static_cast<uint32_t>(toLower(bytes[1])) << 8) | toLower(bytes[2]);
+    }
+
+    /**
+    * Directory the indexes are stored in, `~/.local/bin/ogy/indexes`
+    */
+    static std::string getIndexDirectory();
+
+    /**
+    * Path of the index file of the directory `root`, named after a hash of the path
+    */
+    static std::string getIndexPath(std::string_view root);
+
+    /**
+    * Open the index of `path` or of the closest of its parent directories which has one. `relativePath` is set to the path of `path` inside the index
+    */
+    bool openFor(std::string_view path, std::string& relativePath);
+
+private:
+    /**
+    * Replace the end of `name` as stored at `in`, after the prefix shared with the previous name, and return the position of the next name.
+    * Returns nullptr if the stored name doesn't end before `end` or shares more than `name` has
+    */
+    static const unsigned char* decodeName(const unsigned char* in, const unsigned char* end, std::string& name)
+    {
+        uint64_t sharedLength;
+        uint64_t suffixLength;
+        in = Varint::read(in, end, sharedLength);
+        if (in == nullptr) return nullptr;
+        in = Varint::read(in, end, suffixLength);
+        if (in == nullptr || sharedLength > name.size() || suffixLength > static_cast<uint64_t>(end - in)) return nullptr;
+
+        name.resize(sharedLength);
+        name.append(reinterpret_cast<const char*>(in), suffixLength);
+
+        return in + suffixLength;
+    }
+
+    static unsigned char toLower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c - 'A' + 'a') : static_cast<unsigned char>(c);
+    }
+
+    const Trigram* findTrigram(uint32_t key) const;
+
+    /**
+    * Append the entries of a posting list from `firstEntry` to `lastEntry` (exclusive) to `out`
+    */
+    void decodePostings(const Trigram& trigram, uint32_t firstEntry, uint32_t lastEntry, std::vector<uint32_t>& out) const;
+
+    /**
+    * Whether the header belongs to an index of this version and every section lies inside the file
+    */
+    bool isValid() const;
+
+    /**
+    * Whether the values stored in the sections only refer to directories, entries and bytes which exist,
+    * checked in one pass over each section
+    */
+    bool hasValidContents() const;
+};
@@ -0,0 +1,412 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <string_view>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "IndexBuilder.h"
+#include "../scanner/DirScanner.h"
+#include "../scanner/FileStat.h"
+#include "../utils/ParallelSort.h"
+#include "../utils/ThreadPool.h"
+#include "../utils/WaitGroup.h"
+
+namespace
+{
+    std::string joinPath(std::string_view parent, std::string_view name)
+    {
+        std::string path(parent);
+        if (!path.empty() && path.back() != '/') path += '/';
+        path.append(name);
+
+        return path;
+    }
+
+    /**
+    * Order of directories in the index: pre-order with the children sorted by name.
+    * Comparing paths with '/' ordered before every other byte puts every directory right before its subtree
+    */
+    bool isBeforeInTree(const std::string& a, const std::string& b)
+    {
+        const size_t length = std::min(a.size(), b.size());
+
+        for (size_t i = 0; i < length; i++)
+        {
+            if (a[i] == b[i]) continue;
+            if (a[i] == '/') return true;
+            if (b[i] == '/') return false;
+
+            return static_cast<unsigned char>(a[i]) < static_cast<unsigned char>(b[i]);
+        }
+
+        return a.size() < b.size();
+    }
+
+    size_t alignTo8(size_t offset)
+    {
+        return (offset + 7) & ~static_cast<size_t>(7);
+    }
+
+    bool createDirectories(const std::string& path)
+    {
+        for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1))
+        {
+            const std::string dir = path.substr(0, slash);
+            if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) return false;
+            if (slash == std::string::npos) return true;
+        }
+    }
+}
+
+IndexBuilder::IndexBuilder(std::string root, ThreadPool& threadPool)
+    : root(std::move(root)), threadPool(threadPool)
+{
+}
+
+bool IndexBuilder::build()
+{
+    struct stat rootStat;
+    if (stat(root.c_str(), &rootStat) != 0) return false;
+    if (!S_ISDIR(rootStat.st_mode))
+    {
+        errno = ENOTDIR;
+        return false;
+    }
+
+    loadOldIndex();
+
+    WaitGroup pendingDirs;
+    queueDirectory("", pendingDirs);
+    pendingDirs.wait();
+
+    // Rescanned since the old index, so it isn't needed anymore
+    oldIndex.close();
+    oldDirs.clear();
+
+    if (scannedDirs.empty())
+    {
+        // The root itself couldn't be read
+        errno = EACCES;
+        return false;
+    }
+
+    const std::string contents = serialize();
+
+    stats.numScannedDirs = numScannedDirs.load();
+    stats.numUnreadableDirs = numUnreadableDirs.load();
+    scannedDirs.clear();
+
+    return writeFile(contents);
+}
+
+void IndexBuilder::loadOldIndex()
+{
+    if (!oldIndex.open(FileIndex::getIndexPath(root)) || oldIndex.getRoot() != root)
+    {
+        oldIndex.close();
+        return;
+    }
+
+    oldDirs.reserve(oldIndex.getNumDirs());
+    for (uint32_t dir = 0; dir < oldIndex.getNumDirs(); dir++) oldDirs.emplace(oldIndex.getDirPath(dir), dir);
+}
+
+void IndexBuilder::queueDirectory(std::string path, WaitGroup& pendingDirs)
+{
+    pendingDirs.add();
+
+    // Directories are queued from the workers themselves, so the pool keeps them local and steals the rest
+    threadPool.submit([this, path = std::move(path), &pendingDirs]() {
+        scanDirectory(path, pendingDirs);
+        pendingDirs.done();
+    });
+}
+
+void IndexBuilder::scanDirectory(const std::string& path, WaitGroup& pendingDirs)
+{
+    const std::string fullPath = joinPath(root, path);
+    ScannedDir scanned;
+    scanned.path = path;
+
+    // The time has to be taken before reading, so changes made while reading are picked up by the next build
+    struct stat dirStat;
+    if (fstatat(AT_FDCWD, fullPath.c_str(), &dirStat, AT_SYMLINK_NOFOLLOW) != 0)
+    {
+        numUnreadableDirs++;
+        return;
+    }
+
+    scanned.mtimeSec = dirStat.st_mtim.tv_sec;
+    scanned.mtimeNsec = static_cast<uint32_t>(dirStat.st_mtim.tv_nsec);
+
+    auto oldDir = oldDirs.find(path);
+
+    if (oldDir != oldDirs.end() && oldIndex.getDir(oldDir->second).mtimeSec == scanned.mtimeSec
+        && oldIndex.getDir(oldDir->second).mtimeNsec == scanned.mtimeNsec)
+    {
+        oldIndex.forEachEntry(oldDir->second, oldDir->second + 1, [&](uint32_t, uint32_t entry, std::string_view name) {
+            scanned.names.append(name);
+            scanned.names += '\0';
+            scanned.types.emplace_back(oldIndex.getEntry(entry).type);
+        });
+    }
+    else
+    {
+        DirScanner scanner;
+        if (!scanner.open(fullPath.c_str()))
+        {
+            numUnreadableDirs++;
+            return;
+        }
+
+        numScannedDirs++;
+        DirEntry entry;
+
+        while (scanner.next(entry))
+        {
+            unsigned char type = entry.type;
+            if (type == DT_UNKNOWN)
+            {
+                FileStat fileStat;
+                if (statAt(scanner.getFd(), entry.name.data(), STAT_TYPE, fileStat))
+                {
+                    type = S_ISDIR(fileStat.mode) ? DT_DIR : S_ISLNK(fileStat.mode) ? DT_LNK : DT_REG;
+                }
+            }
+
+            scanned.names.append(entry.name);
+            scanned.names += '\0';
+            scanned.types.emplace_back(type);
+        }
+    }
+
+    // Even directories which didn't change can have changed subdirectories
+    size_t nameStart = 0;
+    for (uint8_t type : scanned.types)
+    {
+        const size_t nameEnd = scanned.names.find('\0', nameStart);
+        if (type == DT_DIR) queueDirectory(joinPath(path, std::string_view(scanned.names).substr(nameStart, nameEnd - nameStart)), pendingDirs);
+        nameStart = nameEnd + 1;
+    }
+
+    std::lock_guard<std::mutex> lg(scannedMutex);
+    scannedDirs.emplace_back(std::move(scanned));
+}
+
+std::string IndexBuilder::serialize()
+{
+    std::sort(scannedDirs.begin(), scannedDirs.end(), [](const ScannedDir& a, const ScannedDir& b) {return isBeforeInTree(a.path, b.path);});
+
+    const uint32_t numDirs = static_cast<uint32_t>(scannedDirs.size());
+    std::unordered_map<std::string_view, uint32_t> dirIds;
+    dirIds.reserve(numDirs);
+    for (uint32_t i = 0; i < numDirs; i++) dirIds.emplace(scannedDirs[i].path, i);
+
+    std::vector<FileIndex::Dir> dirs(numDirs);
+    // Set once the entry of the directory is written to its parent, which is before the directory itself
+    for (auto& dir : dirs) dir.nameEntry = FileIndex::noDir;
+    std::vector<FileIndex::Entry> entries;
+    std::vector<uint64_t> blockOffsets;
+    std::string names;
+    std::string previousName;
+    std::vector<std::string_view> dirNames;
+    std::vector<uint32_t> order;
+    // Trigram key in the high half and entry in the low half, so sorting them groups the entries of every trigram in ascending order
+    std::vector<uint64_t> trigramEntries;
+
+    for (uint32_t i = 0; i < numDirs; i++)
+    {
+        const ScannedDir& scanned = scannedDirs[i];
+        FileIndex::Dir& dir = dirs[i];
+
+        dir.mtimeSec = scanned.mtimeSec;
+        dir.mtimeNsec = scanned.mtimeNsec;
+        dir.parent = FileIndex::noDir;
+        dir.subtreeEnd = i + 1;
+
+        if (!scanned.path.empty())
+        {
+            // Every directory is only queued by its parent, so the parent is always in the index
+            const size_t slash = scanned.path.rfind('/');
+            dir.parent = dirIds.at(slash == std::string::npos ? std::string_view() : std::string_view(scanned.path).substr(0, slash));
+        }
+
+        dirNames.clear();
+        for (size_t start = 0; start < scanned.names.size();)
+        {
+            const size_t end = scanned.names.find('\0', start);
+            dirNames.emplace_back(std::string_view(scanned.names).substr(start, end - start));
+            start = end + 1;
+        }
+
+        order.resize(dirNames.size());
+        for (uint32_t j = 0; j < order.size(); j++) order[j] = j;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {return dirNames[a] < dirNames[b];});
+
+        dir.firstEntry = static_cast<uint32_t>(entries.size());
+        dir.numEntries = static_cast<uint32_t>(order.size());
+
+        for (uint32_t j : order)
+        {
+            const std::string_view name = dirNames[j];
+            const uint32_t entryId = static_cast<uint32_t>(entries.size());
+
+            FileIndex::Entry& entry = entries.emplace_back();
+            entry.type = scanned.types[j];
+            entry.childDir = FileIndex::noDir;
+
+            if (entry.type == DT_DIR)
+            {
+                auto child = dirIds.find(joinPath(scanned.path, name));
+                if (child != dirIds.end())
+                {
+                    entry.childDir = child->second;
+                    dirs[child->second].nameEntry = entryId;
+                }
+            }
+
+            // Front coding: the first name of a block is stored whole, the others after the prefix they share with the previous name
+            if (entryId % FileIndex::entriesPerBlock == 0)
+            {
+                blockOffsets.emplace_back(names.size());
+                previousName.clear();
+            }
+
+            const size_t maxShared = std::min(previousName.size(), name.size());
+            size_t shared = 0;
+            while (shared < maxShared && previousName[shared] == name[shared]) shared++;
+
+            Varint::append(names, shared);
+            Varint::append(names, name.size() - shared);
+            names.append(name.substr(shared));
+            previousName.assign(name);
+
+            for (size_t k = 0; k + FileIndex::trigramLength <= name.size(); k++)
+            {
+                trigramEntries.emplace_back((static_cast<uint64_t>(FileIndex::getTrigramKey(name.data() + k)) << 32) | entryId);
+            }
+
+            // Searches fold these names per character, so they are candidates for every term
+            bool nonAscii = false;
+            for (char c : name) nonAscii |= static_cast<unsigned char>(c) >= 0x80;
+
+            if (nonAscii) trigramEntries.emplace_back((static_cast<uint64_t>(FileIndex::nonAsciiKey) << 32) | entryId);
+        }
+    }
+    blockOffsets.emplace_back(names.size());
+
+    // Children are numbered after their parents, so going backwards every subtree is complete before it is added to its parent
+    for (uint32_t i = numDirs; i-- > 1;)
+    {
+        FileIndex::Dir& parent = dirs[dirs[i].parent];
+        parent.subtreeEnd = std::max(parent.subtreeEnd, dirs[i].subtreeEnd);
+    }
+
+    ParallelSort::sort(trigramEntries, std::less<uint64_t>(), &threadPool);
+
+    std::vector<FileIndex::Trigram> trigrams;
+    std::string postings;
+    uint64_t previousEntry = 0;
+
+    for (size_t k = 0; k < trigramEntries.size(); k++)
+    {
+        const uint32_t key = static_cast<uint32_t>(trigramEntries[k] >> 32);
+        const uint32_t entry = static_cast<uint32_t>(trigramEntries[k]);
+
+        if (trigrams.empty() || trigrams.back().key != key)
+        {
+            trigrams.push_back(FileIndex::Trigram{key, 0, postings.size()});
+            previousEntry = 0;
+        }
+        // A name containing the trigram more than once
+        else if (trigramEntries[k] == trigramEntries[k - 1])
+        {
+            continue;
+        }
+
+        Varint::append(postings, entry - previousEntry);
+        previousEntry = entry;
+        trigrams.back().numEntries++;
+    }
+
+    // Can be as big as the names themselves, so it isn't kept while the file is assembled
+    std::vector<uint64_t>().swap(trigramEntries);
+
+    FileIndex::Header header = {};
+    std::memcpy(header.magic, FileIndex::magic, sizeof(header.magic));
+    header.version = FileIndex::version;
+    header.rootOffset = sizeof(header);
+    header.rootLength = root.size();
+    header.numDirs = numDirs;
+    header.dirsOffset = alignTo8(header.rootOffset + header.rootLength);
+    header.numEntries = entries.size();
+    header.entriesOffset = alignTo8(header.dirsOffset + dirs.size() * sizeof(FileIndex::Dir));
+    header.blockOffsetsOffset = alignTo8(header.entriesOffset + entries.size() * sizeof(FileIndex::Entry));
+    header.namesOffset = header.blockOffsetsOffset + blockOffsets.size() * sizeof(uint64_t);
+    header.namesSize = names.size();
+    header.numTrigrams = trigrams.size();
+    header.trigramsOffset = alignTo8(header.namesOffset + header.namesSize);
+    header.postingsOffset = header.trigramsOffset + trigrams.size() * sizeof(FileIndex::Trigram);
+    header.postingsSize = postings.size();
+    header.fileSize = header.postingsOffset + header.postingsSize;
+
+    std::string contents(header.fileSize, '\0');
+    auto copyTo = [&contents](uint64_t offset, const void* section, size_t sectionSize) {
+        if (sectionSize > 0) std::memcpy(&contents[offset], section, sectionSize);
+    };
+
+    copyTo(0, &header, sizeof(header));
+    copyTo(header.rootOffset, root.data(), root.size());
+    copyTo(header.dirsOffset, dirs.data(), dirs.size() * sizeof(FileIndex::Dir));
+    copyTo(header.entriesOffset, entries.data(), entries.size() * sizeof(FileIndex::Entry));
+    copyTo(header.blockOffsetsOffset, blockOffsets.data(), blockOffsets.size() * sizeof(uint64_t));
+    copyTo(header.namesOffset, names.data(), names.size());
+    copyTo(header.trigramsOffset, trigrams.data(), trigrams.size() * sizeof(FileIndex::Trigram));
+    copyTo(header.postingsOffset, postings.data(), postings.size());
+
+    stats.numDirs = numDirs;
+    stats.numEntries = entries.size();
+
+    return contents;
+}
+
+bool IndexBuilder::writeFile(const std::string& contents)
+{
+    if (!createDirectories(FileIndex::getIndexDirectory())) return false;
+
+    // Written next to the index and renamed over it, so readers never see a partially written index
+    const std::string indexPath = FileIndex::getIndexPath(root);
+    const std::string tempPath = indexPath + ".tmp." + std::to_string(getpid());
+
+    const int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    size_t written = 0;
+    while (written < contents.size())
+    {
+        const ssize_t result = ::write(fd, contents.data() + written, contents.size() - written);
+        if (result < 0)
+        {
+            if (errno == EINTR) continue;
+
+            const int error = errno;
+            ::close(fd);
+            unlink(tempPath.c_str());
+            errno = error;
+            return false;
+        }
+        written += result;
+    }
+
+    if (::close(fd) != 0 || rename(tempPath.c_str(), indexPath.c_str()) != 0)
+    {
+        const int error = errno;
+        unlink(tempPath.c_str());
+        errno = error;
+        return false;
+    }
+
+    return true;
+}
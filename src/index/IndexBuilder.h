@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FileIndex.h"
+
+class ThreadPool;
+class WaitGroup;
+
+/**
+* Builds the FileIndex of a directory tree, scanning the directories in parallel on a ThreadPool.
+* If the directory already has an index, directories whose modification time didn't change since it was built aren't read again:
+* their entries are taken from the old index and only their subdirectories are checked, which on network file systems
+* saves most of the time. A directory's modification time changes whenever an entry is added, removed or renamed in it
+*/
+class IndexBuilder
+{
+public:
+    /**
+    * Numbers about the last build
+    */
+    struct Stats
+    {
+        size_t numDirs = 0;
+        size_t numEntries = 0;
+        size_t numScannedDirs = 0;
+        size_t numUnreadableDirs = 0;
+    };
+
+private:
+    /**
+    * Directory as found by a worker. The names are null-terminated one after another
+    */
+    struct ScannedDir
+    {
+        std::string path; // Relative to the root
+        int64_t mtimeSec = 0;
+        uint32_t mtimeNsec = 0;
+        std::string names;
+        std::vector<uint8_t> types;
+    };
+
+    std::string root;
+    ThreadPool& threadPool;
+
+    FileIndex oldIndex;
+    // Directories of the old index by their relative path
+    std::unordered_map<std::string, uint32_t> oldDirs;
+
+    std::mutex scannedMutex;
+    std::vector<ScannedDir> scannedDirs;
+    std::atomic<size_t> numScannedDirs = 0;
+    std::atomic<size_t> numUnreadableDirs = 0;
+
+    Stats stats;
+
+public:
+    /**
+    * `root` has to be an absolute path without symlinks, e.g. from realpath()
+    */
+    IndexBuilder(std::string root, ThreadPool& threadPool);
+
+    /**
+    * Scan the tree and write the index to FileIndex::getIndexPath(root). Returns false and sets errno if the index can't be written
+    */
+    bool build();
+
+    [[nodiscard]] const Stats& getStats() const { return stats; }
+
+private:
+    void loadOldIndex();
+
+    /**
+    * Read the directory at `path` (relative to the root), or take its entries from the old index, and queue its subdirectories
+    */
+    void scanDirectory(const std::string& path, WaitGroup& pendingDirs);
+
+    void queueDirectory(std::string path, WaitGroup& pendingDirs);
+
+    /**
+    * Number the scanned directories and serialize them into the index file format
+    */
+    std::string serialize();
+
+    bool writeFile(const std::string& contents);
+};
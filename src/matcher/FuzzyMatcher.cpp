@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cstring>
+
+#include "FuzzyMatcher.h"
+
+namespace
+{
+    // The scores of fzf
+    constexpr int scoreMatch = 16;
+    constexpr int scoreGapStart = -3;
+    constexpr int scoreGapExtension = -1;
+    constexpr int bonusBoundary = scoreMatch / 2;
+    constexpr int bonusNonWord = scoreMatch / 2;
+    constexpr int bonusCamel123 = bonusBoundary + scoreGapExtension;
+    constexpr int bonusConsecutive = -(scoreGapStart + scoreGapExtension);
+    constexpr int bonusFirstCharMultiplier = 2;
+    constexpr int bonusBoundaryWhite = bonusBoundary + 2;
+    constexpr int bonusBoundaryDelimiter = bonusBoundary + 1;
+    // Not in fzf: prefers matches in the file name over ones in the directories leading to it
+    constexpr int bonusBasename = 2;
+
+    // Ordered like in fzf, everything after NON_WORD is part of a word
+    enum CharClass : uint8_t
+    {
+        WHITE,
+        NON_WORD,
+        DELIMITER,
+        LOWER,
+        UPPER,
+        LETTER,
+        NUMBER
+    };
+
+    constexpr CharClass getCharClass(unsigned char c)
+    {
+        if (c >= 'a' && c <= 'z') return LOWER;
+        if (c >= 'A' && c <= 'Z') return UPPER;
+        if (c >= '0' && c <= '9') return NUMBER;
+        if (c == ' ' || (c >= '\t' && c <= '\r')) return WHITE;
+        if (c == '/' || c == ',' || c == ':' || c == ';' || c == '|') return DELIMITER;
+        // Bytes of non-ASCII characters
+        if (c >= 0x80) return LETTER;
+        return NON_WORD;
+    }
+
+    constexpr int getBonus(CharClass previous, CharClass current)
+    {
+        if (current > NON_WORD)
+        {
+            if (previous == WHITE) return bonusBoundaryWhite;
+            if (previous == DELIMITER) return bonusBoundaryDelimiter;
+            if (previous == NON_WORD) return bonusBoundary;
+        }
+
+        if ((previous == LOWER && current == UPPER) || (previous != NUMBER && current == NUMBER)) return bonusCamel123;
+        if (current == NON_WORD || current == DELIMITER) return bonusNonWord;
+        if (current == WHITE) return bonusBoundaryWhite;
+        return 0;
+    }
+
+    struct BonusTable
+    {
+        int8_t bonuses[256][256];
+
+        constexpr BonusTable()
+            : bonuses()
+        {
+            for (int previous = 0; previous < 256; previous++)
+            {
+                for (int current = 0; current < 256; current++)
+                {
+                    bonuses[previous][current] = static_cast<int8_t>(getBonus(getCharClass(static_cast<unsigned char>(previous)),
+                        getCharClass(static_cast<unsigned char>(current))));
+                }
+            }
+        }
+    };
+
+    // Bonus of a byte by the byte before it
+    constexpr BonusTable bonusTable;
+
+    char toLowerAscii(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+}
+
+FuzzyMatcher::FuzzyMatcher(std::string_view query)
+    : query(query)
+{
+    for (char& c : this->query) c = toLowerAscii(c);
+}
+
+size_t FuzzyMatcher::findFolded(std::string_view path, size_t position, char c)
+{
+    // memchr compares a whole vector of bytes per step
+    const char* start = path.data() + position;
+    const size_t length = path.size() - position;
+    const char* found = static_cast<const char*>(std::memchr(start, c, length));
+
+    if (c >= 'a' && c <= 'z')
+    {
+        // The uppercase letter only has to be looked for before the lowercase one
+        const size_t searchLength = found ? static_cast<size_t>(found - start) : length;
+        const char* upper = static_cast<const char*>(std::memchr(start, c - 'a' + 'A', searchLength));
+        if (upper != nullptr) found = upper;
+    }
+
+    return found ? static_cast<size_t>(found - path.data()) : path.size();
+}
+
+bool FuzzyMatcher::isCandidate(std::string_view path) const
+{
+    size_t position = 0;
+
+    for (char c : query)
+    {
+        position = findFolded(path, position, c);
+        if (position == path.size()) return false;
+        position++;
+    }
+
+    return true;
+}
+
+int FuzzyMatcher::score(std::string_view path, Buffers& buffers) const
+{
+    const size_t queryLength = query.size();
+    if (queryLength == 0) return 0;
+
+    // Row i of the table starts at the first position the query's first i characters can be matched at
+    std::vector<uint32_t>& firstPositions = buffers.firstPositions;
+    firstPositions.resize(queryLength);
+
+    size_t position = 0;
+    for (size_t i = 0; i < queryLength; i++)
+    {
+        position = findFolded(path, position, query[i]);
+        if (position == path.size()) return noMatch;
+        firstPositions[i] = static_cast<uint32_t>(position++);
+    }
+
+    const size_t first = firstPositions[0];
+    const size_t width = path.size() - first;
+    const size_t lastSlash = path.rfind('/');
+    const size_t basenameStart = lastSlash == std::string_view::npos ? 0 : lastSlash + 1;
+
+    std::vector<int8_t>& bonuses = buffers.bonuses;
+    bonuses.resize(width);
+    // The start of the path counts as coming after a delimiter
+    unsigned char previous = '/';
+    if (first > 0) previous = static_cast<unsigned char>(path[first - 1]);
+
+    for (size_t j = 0; j < width; j++)
+    {
+        const unsigned char current = static_cast<unsigned char>(path[first + j]);
+        bonuses[j] = bonusTable.bonuses[previous][current];
+        previous = current;
+    }
+
+    // Best score with query character i at or before each position, and the length of the run of consecutive matches ending there.
+    // Every cell that is read was written for this path, so the buffers are only grown, not cleared
+    std::vector<int32_t>& scores = buffers.scores;
+    std::vector<uint16_t>& consecutive = buffers.consecutive;
+    scores.resize(queryLength * width);
+    consecutive.resize(queryLength * width);
+
+    auto basenameBonus = [basenameStart, first](size_t j) {return first + j >= basenameStart ? bonusBasename : 0;};
+
+    // The first query character
+    int previousScore = 0;
+    bool inGap = false;
+
+    for (size_t j = 0; j < width; j++)
+    {
+        if (toLowerAscii(path[first + j]) == query[0])
+        {
+            scores[j] = scoreMatch + bonuses[j] * bonusFirstCharMultiplier + basenameBonus(j);
+            consecutive[j] = 1;
+            inGap = false;
+        }
+        else
+        {
+            scores[j] = std::max(previousScore + (inGap ? scoreGapExtension : scoreGapStart), 0);
+            consecutive[j] = 0;
+            inGap = true;
+        }
+        previousScore = scores[j];
+    }
+
+    int bestScore = queryLength == 1 ? *std::max_element(scores.begin(), scores.begin() + width) : 0;
+
+    for (size_t i = 1; i < queryLength; i++)
+    {
+        const char c = query[i];
+        int32_t* row = scores.data() + i * width;
+        const int32_t* previousRow = row - width;
+        uint16_t* consecutiveRow = consecutive.data() + i * width;
+        const uint16_t* previousConsecutiveRow = consecutiveRow - width;
+        const bool lastRow = i + 1 == queryLength;
+
+        inGap = false;
+        const size_t start = firstPositions[i] - first;
+
+        for (size_t j = start; j < width; j++)
+        {
+            const int gapScore = j > start ? row[j - 1] + (inGap ? scoreGapExtension : scoreGapStart) : 0;
+            int matchScore = 0;
+            int run = 0;
+
+            if (toLowerAscii(path[first + j]) == c)
+            {
+                matchScore = previousRow[j - 1] + scoreMatch + basenameBonus(j);
+                int bonus = bonuses[j];
+                run = previousConsecutiveRow[j - 1] + 1;
+
+                if (run > 1)
+                {
+                    // A run keeps the bonus of its first character, unless this one starts a new word
+                    const int runBonus = bonuses[j - run + 1];
+                    if (bonus >= bonusBoundary && bonus > runBonus) run = 1;
+                    else bonus = std::max(bonus, std::max(bonusConsecutive, runBonus));
+                }
+
+                if (matchScore + bonus < gapScore)
+                {
+                    matchScore += bonuses[j];
+                    run = 0;
+                }
+                else matchScore += bonus;
+            }
+
+            inGap = matchScore < gapScore;
+            row[j] = std::max({matchScore, gapScore, 0});
+            consecutiveRow[j] = static_cast<uint16_t>(run);
+
+            if (lastRow) bestScore = std::max(bestScore, row[j]);
+        }
+    }
+
+    return bestScore;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+* Fuzzy matching and scoring of paths against a query, the way fzf ranks them.
+*
+* A path matches if it contains the characters of the query in order, ignoring ASCII case. Its score is that of the best alignment
+* of the query, found with the Smith-Waterman style dynamic programming of fzf's v2 algorithm: every matched character scores,
+* gaps between them cost, and characters at word boundaries (after '/', '_', '-', '.', spaces or a lowercase letter for camelCase)
+* and runs of consecutive characters get bonuses. Characters matched in the file name itself, after the last '/', get an extra bonus.
+* Const and shared by all threads; every thread passes its own Buffers, so scoring doesn't allocate per path
+*/
+class FuzzyMatcher
+{
+public:
+    static constexpr int noMatch = -1;
+
+    /**
+    * Scratch memory for scoring, reused for every path scored on a thread
+    */
+    struct Buffers
+    {
+        std::vector<int32_t> scores;
+        std::vector<uint16_t> consecutive;
+        std::vector<int8_t> bonuses;
+        std::vector<uint32_t> firstPositions;
+    };
+
+private:
+    // Lowercased
+    std::string query;
+
+public:
+    explicit FuzzyMatcher(std::string_view query);
+
+    /**
+    * Whether `path` contains the query as a subsequence, which is much cheaper to check than scoring it
+    */
+    [[nodiscard]] bool isCandidate(std::string_view path) const;
+
+    /**
+    * Score of the best alignment of the query in `path`, higher is better, or noMatch if it doesn't contain the query
+    */
+    [[nodiscard]] int score(std::string_view path, Buffers& buffers) const;
+
+private:
+    /**
+    * Find the first position of `c`, in either case, from `position`. Returns the end of `path` if there is none
+    */
+    static size_t findFolded(std::string_view path, size_t position, char c);
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "PatternMatcher.h"
+#include "SubstringMatcher.h"
+
+/**
+* The find term as a substring, glob or regular expression, so the searches don't depend on how it is matched.
+* Compiled once and shared by all threads
+*/
+class NameMatcher
+{
+public:
+    enum class Mode
+    {
+        SUBSTRING,
+        GLOB,
+        REGEX
+    };
+
+private:
+    std::optional<SubstringMatcher> substring;
+    std::optional<PatternMatcher> pattern;
+    std::string error;
+
+public:
+    /**
+    * Compile `term`. Returns false and sets the error if it isn't a valid pattern
+    */
+    bool compile(std::string_view term, Mode mode)
+    {
+        substring.reset();
+        pattern.reset();
+
+        if (mode == Mode::SUBSTRING)
+        {
+            substring.emplace(term);
+            return true;
+        }
+
+        pattern.emplace();
+        if (pattern->compile(term, mode == Mode::GLOB ? PatternMatcher::Syntax::GLOB : PatternMatcher::Syntax::REGEX)) return true;
+
+        error = pattern->getError();
+        pattern.reset();
+        return false;
+    }
+
+    [[nodiscard]] bool matches(std::string_view name) const
+    {
+        return substring ? substring->matches(name) : pattern->matches(name);
+    }
+
+    /**
+    * Lowercased ASCII literal which every matching name contains ignoring ASCII case, for FileIndex::findCandidates. Empty if there is none
+    */
+    [[nodiscard]] std::string_view getRequiredLiteral() const
+    {
+        if (substring) return substring->isAsciiTerm() ? std::string_view(substring->getAsciiTerm()) : std::string_view();
+        return pattern->getRequiredLiteral();
+    }
+
+    [[nodiscard]] const std::string& getError() const { return error; }
+};
@@ -0,0 +1,948 @@
+#include <algorithm>
+#include <bitset>
+#include <map>
+
+#include "PatternMatcher.h"
+
+namespace
+{
+    /**
+    * Node of a parsed pattern
+    */
+    struct Node
+    {
+        enum class Type
+        {
+            CHARS, // One character
+            CONCAT,
+            ALTERNATE,
+            REPEAT,
+            ANY_BYTES // Any number of any bytes, `*` in globs and `.*` in regular expressions
+        };
+
+        Type type = Type::CONCAT;
+        // CHARS: the single bytes matched, ASCII letters in both cases
+        std::bitset<256> bytes;
+        // CHARS: also matches every multi-byte UTF-8 character
+        bool anyMultibyte = false;
+        // CHARS: multi-byte UTF-8 characters matched
+        std::vector<std::string> sequences;
+        std::vector<Node> children;
+        // REPEAT: -1 for no maximum
+        int min = 0;
+        int max = 0;
+    };
+
+    // The longest `{m,n}` count, since the repeated part is copied that many times
+    constexpr int maxRepeat = 1000;
+    constexpr size_t maxNfaStates = 100000;
+
+    bool isAsciiLetter(unsigned char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+
+    void addByte(std::bitset<256>& bytes, unsigned char c)
+    {
+        bytes.set(c);
+        if (isAsciiLetter(c)) bytes.set(c ^ 0x20);
+    }
+
+    Node makeChars()
+    {
+        Node node;
+        node.type = Node::Type::CHARS;
+        return node;
+    }
+
+    Node makeAnyChar()
+    {
+        Node node = makeChars();
+        for (int c = 0; c < 0x80; c++) node.bytes.set(c);
+        node.anyMultibyte = true;
+        return node;
+    }
+
+    bool isAnyChar(const Node& node)
+    {
+        return node.type == Node::Type::CHARS && node.anyMultibyte && node.bytes.count() == 0x80 && node.sequences.empty();
+    }
+
+    void appendToConcat(Node& concat, Node node)
+    {
+        // Groups are spliced in, so literals around and inside them form one run
+        if (node.type == Node::Type::CONCAT)
+        {
+            for (auto& child : node.children) concat.children.emplace_back(std::move(child));
+        }
+        else concat.children.emplace_back(std::move(node));
+    }
+
+    /**
+    * Parser for both syntaxes. Errors are kept in `error`, after which the result is discarded
+    */
+    class PatternParser
+    {
+    private:
+        std::string_view pattern;
+        size_t pos = 0;
+
+    public:
+        std::string error;
+
+        explicit PatternParser(std::string_view pattern)
+            : pattern(pattern)
+        {
+        }
+
+        [[nodiscard]] bool atEnd() const { return pos >= pattern.size() || !error.empty(); }
+
+        Node parseGlob(bool inBraces)
+        {
+            Node concat;
+
+            while (!atEnd())
+            {
+                const char c = pattern[pos];
+
+                if (inBraces && (c == ',' || c == '}')) break;
+
+                if (c == '*')
+                {
+                    pos++;
+                    Node anyBytes;
+                    anyBytes.type = Node::Type::ANY_BYTES;
+                    concat.children.emplace_back(std::move(anyBytes));
+                }
+                else if (c == '?')
+                {
+                    pos++;
+                    concat.children.emplace_back(makeAnyChar());
+                }
+                else if (c == '[')
+                {
+                    pos++;
+                    concat.children.emplace_back(parseBracket(true));
+                }
+                else if (c == '{' && hasClosingBrace(pos + 1))
+                {
+                    pos++;
+                    Node alternate;
+                    alternate.type = Node::Type::ALTERNATE;
+                    bool closed = false;
+
+                    while (!closed)
+                    {
+                        alternate.children.emplace_back(parseGlob(true));
+                        if (atEnd()) break;
+                        closed = pattern[pos++] == '}';
+                    }
+
+                    if (error.empty() && !closed) error = "missing '}'";
+                    concat.children.emplace_back(std::move(alternate));
+                }
+                else if (c == '\\' && pos + 1 < pattern.size())
+                {
+                    pos++;
+                    concat.children.emplace_back(parseLiteral());
+                }
+                else concat.children.emplace_back(parseLiteral());
+            }
+
+            return concat;
+        }
+
+        /**
+        * Whether the glob brace opened before `start` is closed at the same nesting level. Otherwise the `{` is a literal, like in shells
+        */
+        bool hasClosingBrace(size_t start) const
+        {
+            int depth = 1;
+
+            for (size_t i = start; i < pattern.size(); i++)
+            {
+                const char c = pattern[i];
+
+                if (c == '\\') i++;
+                else if (c == '{') depth++;
+                else if (c == '}' && --depth == 0) return true;
+                else if (c == '[')
+                {
+                    // Braces in bracket expressions are literals
+                    i++;
+                    if (i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^')) i++;
+                    if (i < pattern.size() && pattern[i] == ']') i++;
+
+                    while (i < pattern.size() && pattern[i] != ']')
+                    {
+                        if (pattern[i] == '\\') i++;
+                        i++;
+                    }
+                }
+            }
+
+            return false;
+        }
+
+        Node parseRegex()
+        {
+            Node alternate;
+            alternate.type = Node::Type::ALTERNATE;
+            alternate.children.emplace_back(parseRegexConcat());
+
+            while (!atEnd() && pattern[pos] == '|')
+            {
+                pos++;
+                alternate.children.emplace_back(parseRegexConcat());
+            }
+
+            if (alternate.children.size() == 1) return std::move(alternate.children[0]);
+            return alternate;
+        }
+
+    private:
+        Node parseRegexConcat()
+        {
+            Node concat;
+
+            while (!atEnd() && pattern[pos] != '|' && pattern[pos] != ')')
+            {
+                Node atom = parseRegexAtom();
+                if (!error.empty()) break;
+
+                appendToConcat(concat, parseQuantifiers(std::move(atom)));
+            }
+
+            return concat;
+        }
+
+        Node parseRegexAtom()
+        {
+            const char c = pattern[pos];
+
+            switch (c)
+            {
+            case '(':
+            {
+                pos++;
+                // Groups don't capture anyway, so `(?:` is the same
+                if (pattern.substr(pos, 2) == "?:") pos += 2;
+
+                Node group = parseRegex();
+                if (error.empty() && (pos >= pattern.size() || pattern[pos] != ')')) error = "missing ')'";
+                pos++;
+                return group;
+            }
+            case '.':
+                pos++;
+                return makeAnyChar();
+            case '[':
+                pos++;
+                return parseBracket(false);
+            case '\\':
+                pos++;
+                return parseEscape(false);
+            case '*':
+            case '+':
+            case '?':
+                error = std::string("nothing to repeat before '") + c + "'";
+                return Node();
+            case '^':
+            case '$':
+                error = "'^' and '$' are only supported at the start and end of the pattern";
+                return Node();
+            default:
+                return parseLiteral();
+            }
+        }
+
+        Node parseQuantifiers(Node atom)
+        {
+            while (!atEnd())
+            {
+                int min;
+                int max;
+                const char c = pattern[pos];
+
+                if (c == '*') { min = 0; max = -1; pos++; }
+                else if (c == '+') { min = 1; max = -1; pos++; }
+                else if (c == '?') { min = 0; max = 1; pos++; }
+                else if (c == '{' && parseCount(min, max)) {}
+                else break;
+
+                if (!error.empty()) break;
+
+                // Matches the same names as repeating whole characters, but needs no states per character
+                if (isAnyChar(atom) && max == -1)
+                {
+                    Node anyBytes;
+                    anyBytes.type = Node::Type::ANY_BYTES;
+
+                    if (min == 0) atom = std::move(anyBytes);
+                    else
+                    {
+                        // At least `min` characters, then anything
+                        Node repeat;
+                        repeat.type = Node::Type::REPEAT;
+                        repeat.min = min;
+                        repeat.max = min;
+                        repeat.children.emplace_back(std::move(atom));
+
+                        Node concat;
+                        concat.children.emplace_back(std::move(repeat));
+                        concat.children.emplace_back(std::move(anyBytes));
+                        atom = std::move(concat);
+                    }
+                    continue;
+                }
+
+                Node repeat;
+                repeat.type = Node::Type::REPEAT;
+                repeat.min = min;
+                repeat.max = max;
+                repeat.children.emplace_back(std::move(atom));
+                atom = std::move(repeat);
+            }
+
+            return atom;
+        }
+
+        /**
+        * Parse `{m}`, `{m,}` or `{m,n}` at the current position. A `{` not starting a count is a literal
+        */
+        bool parseCount(int& min, int& max)
+        {
+            size_t end = pos + 1;
+            auto readNumber = [&](int& number) {
+                const size_t start = end;
+                number = 0;
+                while (end < pattern.size() && pattern[end] >= '0' && pattern[end] <= '9')
+                {
+                    number = std::min(number * 10 + (pattern[end++] - '0'), maxRepeat + 1);
+                }
+                return end > start;
+            };
+
+            if (!readNumber(min)) return false;
+
+            if (end < pattern.size() && pattern[end] == ',')
+            {
+                end++;
+                if (!readNumber(max)) max = -1;
+            }
+            else max = min;
+
+            if (end >= pattern.size() || pattern[end] != '}') return false;
+            pos = end + 1;
+
+            if (min > maxRepeat || max > maxRepeat) error = "repeat counts can be at most " + std::to_string(maxRepeat);
+            else if (max != -1 && max < min) error = "invalid repeat count";
+
+            return true;
+        }
+
+        /**
+        * Parse a single character, which can be several bytes
+        */
+        Node parseLiteral()
+        {
+            Node node = makeChars();
+            const std::string character = readCharacter();
+
+            if (character.size() == 1) addByte(node.bytes, static_cast<unsigned char>(character[0]));
+            else node.sequences.emplace_back(character);
+
+            return node;
+        }
+
+        std::string readCharacter()
+        {
+            const unsigned char lead = static_cast<unsigned char>(pattern[pos]);
+            size_t length = 1;
+
+            if ((lead & 0xe0) == 0xc0) length = 2;
+            else if ((lead & 0xf0) == 0xe0) length = 3;
+            else if ((lead & 0xf8) == 0xf0) length = 4;
+
+            // Invalid UTF-8 in the pattern only matches the same bytes
+            for (size_t i = 1; i < length; i++)
+            {
+                if (pos + i >= pattern.size() || (static_cast<unsigned char>(pattern[pos + i]) & 0xc0) != 0x80) length = 1;
+            }
+
+            const std::string character(pattern.substr(pos, length));
+            pos += length;
+            return character;
+        }
+
+        /**
+        * Parse the escape after a `\`. `\d`, `\w` and `\s` are sets of ASCII characters, other punctuation is taken literally
+        */
+        Node parseEscape(bool inBracket)
+        {
+            if (pos >= pattern.size())
+            {
+                error = "trailing '\\'";
+                return Node();
+            }
+
+            const char c = pattern[pos];
+            Node node = makeChars();
+
+            auto addClass = [&node](char name) {
+                for (int b = 0; b < 0x80; b++)
+                {
+                    const bool digit = b >= '0' && b <= '9';
+                    if ((name == 'd' && digit)
+                        || (name == 'w' && (digit || isAsciiLetter(b) || b == '_'))
+                        || (name == 's' && (b == ' ' || (b >= '\t' && b <= '\r'))))
+                    {
+                        node.bytes.set(b);
+                    }
+                }
+            };
+
+            switch (c)
+            {
+            case 'd':
+            case 'w':
+            case 's':
+                pos++;
+                addClass(c);
+                return node;
+            case 'D':
+            case 'W':
+            case 'S':
+                if (inBracket)
+                {
+                    error = std::string("'\\") + c + "' isn't supported inside brackets";
+                    return node;
+                }
+                pos++;
+                addClass(static_cast<char>(c | 0x20));
+                return negate(std::move(node));
+            case 't':
+                pos++;
+                node.bytes.set('\t');
+                return node;
+            case 'n':
+                pos++;
+                node.bytes.set('\n');
+                return node;
+            default:
+                if (isAsciiLetter(static_cast<unsigned char>(c)) || (c >= '0' && c <= '9'))
+                {
+                    error = std::string("unknown escape '\\") + c + "'";
+                    return node;
+                }
+                return parseLiteral();
+            }
+        }
+
+        /**
+        * The characters not in `node`, which can only have ASCII characters
+        */
+        static Node negate(Node node)
+        {
+            for (int b = 0; b < 0x80; b++) node.bytes.flip(b);
+            node.anyMultibyte = true;
+            return node;
+        }
+
+        /**
+        * Parse a bracket expression after its `[`
+        */
+        Node parseBracket(bool glob)
+        {
+            Node node = makeChars();
+            bool negated = false;
+
+            if (pos < pattern.size() && (pattern[pos] == '^' || (glob && pattern[pos] == '!')))
+            {
+                negated = true;
+                pos++;
+            }
+
+            bool first = true;
+
+            while (error.empty())
+            {
+                if (pos >= pattern.size())
+                {
+                    error = "missing ']'";
+                    break;
+                }
+
+                // A `]` right at the start is a literal
+                if (pattern[pos] == ']' && !first)
+                {
+                    pos++;
+                    break;
+                }
+                first = false;
+
+                Node item = parseBracketItem(glob);
+                if (!error.empty()) break;
+
+                // A range, unless the `-` is the last character
+                if (pos + 1 < pattern.size() && pattern[pos] == '-' && pattern[pos + 1] != ']')
+                {
+                    pos++;
+                    const size_t rangeStart = pos;
+                    Node end = parseBracketItem(glob);
+                    if (!error.empty()) break;
+
+                    const int low = getSingleByte(item);
+                    const int high = getSingleByte(end);
+
+                    if (low < 0 || high < 0 || low > 0x7f || high > 0x7f)
+                    {
+                        error = "ranges have to be between ASCII characters";
+                        break;
+                    }
+                    if (low > high)
+                    {
+                        error = "invalid range ending at '" + std::string(pattern.substr(rangeStart, pos - rangeStart)) + "'";
+                        break;
+                    }
+
+                    for (int b = low; b <= high; b++) addByte(node.bytes, static_cast<unsigned char>(b));
+                    continue;
+                }
+
+                node.bytes |= item.bytes;
+                for (auto& sequence : item.sequences) node.sequences.emplace_back(std::move(sequence));
+            }
+
+            if (!negated) return node;
+
+            if (!node.sequences.empty() || (node.bytes >> 0x80).any())
+            {
+                if (error.empty()) error = "negated brackets can only contain ASCII characters";
+                return node;
+            }
+
+            return negate(std::move(node));
+        }
+
+        /**
+        * Parse a character of a bracket expression, which can be escaped
+        */
+        Node parseBracketItem(bool glob)
+        {
+            if (pattern[pos] != '\\') return parseLiteral();
+
+            pos++;
+            if (pos >= pattern.size())
+            {
+                error = "missing ']'";
+                return Node();
+            }
+
+            return glob ? parseLiteral() : parseEscape(true);
+        }
+
+        /**
+        * The byte of a single character without its other case, or -1 if it is several bytes or a class
+        */
+        static int getSingleByte(const Node& node)
+        {
+            if (!node.sequences.empty() || node.anyMultibyte) return -1;
+
+            int found = -1;
+            for (int b = 0; b < 256; b++)
+            {
+                if (!node.bytes.test(b)) continue;
+                // Letters are in both cases, the lowercase one comes last
+                if (found >= 0 && !(isAsciiLetter(static_cast<unsigned char>(b)) && (b ^ 0x20) == found)) return -1;
+                found = b;
+            }
+
+            return found;
+        }
+    };
+
+    /**
+    * The lowercased character `node` matches if it is a single ASCII character, otherwise 0
+    */
+    char getLiteral(const Node& node)
+    {
+        if (node.type != Node::Type::CHARS || node.anyMultibyte || !node.sequences.empty()) return 0;
+
+        const size_t count = node.bytes.count();
+        for (int b = 0; b < 0x80; b++)
+        {
+            if (!node.bytes.test(b)) continue;
+
+            if (count == 1) return static_cast<char>(b);
+            if (count == 2 && isAsciiLetter(static_cast<unsigned char>(b))) return static_cast<char>(b | 0x20);
+            return 0;
+        }
+        return 0;
+    }
+
+    /**
+    * Longest run of literal characters that every match of `node` contains
+    */
+    std::string findRequiredLiteral(const Node& node)
+    {
+        std::string longest;
+        auto keepLongest = [&longest](const std::string& literal) {if (literal.size() > longest.size()) longest = literal;};
+
+        switch (node.type)
+        {
+        case Node::Type::CHARS:
+            if (char c = getLiteral(node)) longest = std::string(1, c);
+            break;
+        case Node::Type::CONCAT:
+        {
+            std::string run;
+            for (const auto& child : node.children)
+            {
+                if (char c = getLiteral(child))
+                {
+                    run += c;
+                    continue;
+                }
+
+                keepLongest(run);
+                run.clear();
+                keepLongest(findRequiredLiteral(child));
+            }
+            keepLongest(run);
+            break;
+        }
+        case Node::Type::REPEAT:
+            if (node.min > 0) longest = findRequiredLiteral(node.children[0]);
+            break;
+        default:
+            break;
+        }
+
+        return longest;
+    }
+
+    /**
+    * Thompson NFA: every state has epsilon edges and edges over sets of bytes
+    */
+    class Nfa
+    {
+    public:
+        struct State
+        {
+            std::vector<int> epsilons;
+            // Byte set and target state
+            std::vector<std::pair<int, int>> edges;
+        };
+
+        std::vector<State> states;
+        std::vector<std::bitset<256>> byteSets;
+        bool tooLarge = false;
+
+        int addState()
+        {
+            if (states.size() >= maxNfaStates)
+            {
+                tooLarge = true;
+                return 0;
+            }
+
+            states.emplace_back();
+            return static_cast<int>(states.size() - 1);
+        }
+
+        /**
+        * Add the states matching `node` after state `from` and return the state reached at its end
+        */
+        int build(const Node& node, int from)
+        {
+            if (tooLarge) return from;
+
+            switch (node.type)
+            {
+            case Node::Type::CHARS:
+                return buildChars(node, from);
+            case Node::Type::CONCAT:
+                for (const auto& child : node.children) from = build(child, from);
+                return from;
+            case Node::Type::ALTERNATE:
+            {
+                const int end = addState();
+                for (const auto& child : node.children)
+                {
+                    const int start = addState();
+                    addEpsilon(from, start);
+                    addEpsilon(build(child, start), end);
+                }
+                return end;
+            }
+            case Node::Type::REPEAT:
+            {
+                for (int i = 0; i < node.min; i++) from = build(node.children[0], from);
+
+                if (node.max == -1)
+                {
+                    const int loop = addState();
+                    addEpsilon(from, loop);
+                    addEpsilon(build(node.children[0], loop), loop);
+                    return loop;
+                }
+
+                const int end = addState();
+                for (int i = node.min; i < node.max; i++)
+                {
+                    addEpsilon(from, end);
+                    from = build(node.children[0], from);
+                }
+                addEpsilon(from, end);
+                return end;
+            }
+            case Node::Type::ANY_BYTES:
+            {
+                const int loop = addState();
+                addEpsilon(from, loop);
+                addEdge(loop, range(0x00, 0xff), loop);
+                return loop;
+            }
+            }
+
+            return from;
+        }
+
+    private:
+        int buildChars(const Node& node, int from)
+        {
+            const int end = addState();
+            if (node.bytes.any()) addEdge(from, node.bytes, end);
+
+            for (const auto& sequence : node.sequences)
+            {
+                int state = from;
+                for (size_t i = 0; i + 1 < sequence.size(); i++)
+                {
+                    const int next = addState();
+                    addEdge(state, byteSet(static_cast<unsigned char>(sequence[i])), next);
+                    state = next;
+                }
+                addEdge(state, byteSet(static_cast<unsigned char>(sequence.back())), end);
+            }
+
+            if (node.anyMultibyte)
+            {
+                // Lead bytes of 2, 3 and 4 byte characters followed by their continuation bytes
+                const std::pair<int, int> leads[] = {{0xc0, 0xdf}, {0xe0, 0xef}, {0xf0, 0xf7}};
+
+                for (int length = 2; length <= 4; length++)
+                {
+                    int state = addState();
+                    addEdge(from, range(leads[length - 2].first, leads[length - 2].second), state);
+
+                    for (int i = 2; i < length; i++)
+                    {
+                        const int next = addState();
+                        addEdge(state, range(0x80, 0xbf), next);
+                        state = next;
+                    }
+                    addEdge(state, range(0x80, 0xbf), end);
+                }
+            }
+
+            return end;
+        }
+
+        void addEpsilon(int from, int to)
+        {
+            if (!tooLarge) states[from].epsilons.emplace_back(to);
+        }
+
+        void addEdge(int from, const std::bitset<256>& bytes, int to)
+        {
+            if (tooLarge) return;
+
+            byteSets.emplace_back(bytes);
+            states[from].edges.emplace_back(static_cast<int>(byteSets.size() - 1), to);
+        }
+
+        static std::bitset<256> byteSet(unsigned char c)
+        {
+            std::bitset<256> bytes;
+            bytes.set(c);
+            return bytes;
+        }
+
+        static std::bitset<256> range(int low, int high)
+        {
+            std::bitset<256> bytes;
+            for (int b = low; b <= high; b++) bytes.set(b);
+            return bytes;
+        }
+    };
+}
+
+bool PatternMatcher::compile(std::string_view pattern, Syntax syntax)
+{
+    error.clear();
+
+    bool anchoredStart = syntax == Syntax::GLOB;
+    bool anchoredEnd = syntax == Syntax::GLOB;
+
+    if (syntax == Syntax::REGEX)
+    {
+        if (!pattern.empty() && pattern[0] == '^')
+        {
+            anchoredStart = true;
+            pattern.remove_prefix(1);
+        }
+
+        // Unless the `$` is escaped
+        size_t backslashes = 0;
+        while (backslashes + 1 < pattern.size() && pattern[pattern.size() - 2 - backslashes] == '\\') backslashes++;
+
+        if (!pattern.empty() && pattern.back() == '$' && backslashes % 2 == 0)
+        {
+            anchoredEnd = true;
+            pattern.remove_suffix(1);
+        }
+    }
+
+    PatternParser parser(pattern);
+    Node root = syntax == Syntax::GLOB ? parser.parseGlob(false) : parser.parseRegex();
+
+    // A `)` without a `(` stops the regular expression early
+    if (parser.error.empty() && !parser.atEnd()) parser.error = "unmatched ')'";
+
+    if (!parser.error.empty())
+    {
+        error = parser.error;
+        return false;
+    }
+
+    requiredLiteral = findRequiredLiteral(root);
+    // A single character isn't worth searching for twice
+    if (requiredLiteral.size() >= 2) prefilter.emplace(requiredLiteral);
+    else prefilter.reset();
+
+    // Matching anywhere in the name is matching the whole name with anything before and after it
+    Node whole;
+    Node anyBytes;
+    anyBytes.type = Node::Type::ANY_BYTES;
+
+    if (!anchoredStart) whole.children.emplace_back(anyBytes);
+    whole.children.emplace_back(std::move(root));
+    acceptPrefix = !anchoredEnd;
+
+    Nfa nfa;
+    const int nfaStart = nfa.addState();
+    const int nfaEnd = nfa.build(whole, nfaStart);
+
+    if (nfa.tooLarge)
+    {
+        error = "the pattern is too complex";
+        return false;
+    }
+
+    // Bytes which are in the same byte sets behave the same, so each group of them needs only one column in the table
+    byteClasses.fill(0);
+    numClasses = 1;
+
+    for (const auto& bytes : nfa.byteSets)
+    {
+        std::array<int, 512> split;
+        split.fill(-1);
+        size_t newNumClasses = 0;
+
+        for (int b = 0; b < 256; b++)
+        {
+            int& newClass = split[byteClasses[b] * 2 + bytes.test(b)];
+            if (newClass < 0) newClass = static_cast<int>(newNumClasses++);
+            byteClasses[b] = static_cast<uint8_t>(newClass);
+        }
+
+        numClasses = newNumClasses;
+        if (numClasses == 256) break;
+    }
+
+    std::vector<int> classBytes(numClasses);
+    for (int b = 255; b >= 0; b--) classBytes[byteClasses[b]] = b;
+
+    // Subset construction: every DFA state is the set of NFA states reachable with the bytes read so far
+    auto closure = [&nfa](std::vector<int>& set) {
+        std::vector<int> pending(set);
+        std::vector<bool> seen(nfa.states.size());
+        for (int state : set) seen[state] = true;
+
+        while (!pending.empty())
+        {
+            const int state = pending.back();
+            pending.pop_back();
+
+            for (int next : nfa.states[state].epsilons)
+            {
+                if (seen[next]) continue;
+                seen[next] = true;
+                set.emplace_back(next);
+                pending.emplace_back(next);
+            }
+        }
+
+        std::sort(set.begin(), set.end());
+    };
+
+    std::map<std::vector<int>, uint32_t> dfaStates;
+    std::vector<std::vector<int>> sets;
+
+    auto addDfaState = [&](std::vector<int> set) {
+        auto it = dfaStates.find(set);
+        if (it != dfaStates.end()) return it->second;
+
+        const uint32_t id = static_cast<uint32_t>(sets.size());
+        accepting.emplace_back(std::binary_search(set.begin(), set.end(), nfaEnd));
+        dfaStates.emplace(set, id);
+        sets.emplace_back(std::move(set));
+        return id;
+    };
+
+    accepting.clear();
+    transitions.clear();
+
+    // The dead state, from which nothing matches
+    addDfaState({});
+
+    std::vector<int> startSet = {nfaStart};
+    closure(startSet);
+    startState = addDfaState(std::move(startSet));
+
+    for (uint32_t id = 0; id < sets.size(); id++)
+    {
+        if (sets.size() > maxDfaStates)
+        {
+            error = "the pattern is too complex";
+            return false;
+        }
+
+        transitions.resize((id + 1) * numClasses, deadState);
+
+        for (size_t byteClass = 0; byteClass < numClasses; byteClass++)
+        {
+            std::vector<int> next;
+            for (int state : sets[id])
+            {
+                for (const auto& [byteSet, target] : nfa.states[state].edges)
+                {
+                    if (nfa.byteSets[byteSet].test(classBytes[byteClass])) next.emplace_back(target);
+                }
+            }
+
+            if (next.empty()) continue;
+
+            std::sort(next.begin(), next.end());
+            next.erase(std::unique(next.begin(), next.end()), next.end());
+            closure(next);
+
+            const uint32_t target = addDfaState(std::move(next));
+            transitions[id * numClasses + byteClass] = target;
+        }
+    }
+
+    return true;
+}
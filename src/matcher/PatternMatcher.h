@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "SubstringMatcher.h"
+
+/**
+* Glob or regular expression for file names, compiled once into a DFA and shared by all threads.
+*
+* The pattern is parsed into an NFA, which is turned into a DFA with a transition table over byte classes (bytes no part of the
+* pattern tells apart share a column), so matching a name is one table lookup per byte without allocating anything. `.` and `?`
+* match one UTF-8 character and ASCII letters match either case, like find terms. Globs match the whole name and support `*`, `?`,
+* `[...]` (negated with `!` or `^`) and `{a,b}` (an unmatched `{` is a literal). Regular expressions match anywhere in the name unless anchored with `^` and `$`
+* and support `|`, groups, `*`, `+`, `?`, `{m,n}`, `.`, brackets and the escapes `\d`, `\w` and `\s` with their negations.
+*
+* The longest literal every matching name contains is searched with a SubstringMatcher first, which rejects most names faster than the DFA
+*/
+class PatternMatcher
+{
+public:
+    enum class Syntax
+    {
+        GLOB,
+        REGEX
+    };
+
+    // More states than this are only needed by patterns like `(a|b)*a.{20}`
+    static constexpr size_t maxDfaStates = 10000;
+
+private:
+    static constexpr uint32_t deadState = 0;
+
+    std::array<uint8_t, 256> byteClasses{};
+    size_t numClasses = 0;
+    // Next state for every state and byte class
+    std::vector<uint32_t> transitions;
+    std::vector<uint8_t> accepting;
+    uint32_t startState = deadState;
+    // Any name with an accepted prefix matches, so the rest doesn't have to be read
+    bool acceptPrefix = false;
+
+    std::string requiredLiteral;
+    std::optional<SubstringMatcher> prefilter;
+    std::string error;
+
+public:
+    /**
+    * Compile `pattern`. Returns false and sets the error if it is invalid or too complex
+    */
+    bool compile(std::string_view pattern, Syntax syntax);
+
+    /**
+    * Whether `name` matches the compiled pattern
+    */
+    [[nodiscard]] bool matches(std::string_view name) const
+    {
+        if (prefilter && !prefilter->matches(name)) return false;
+
+        uint32_t state = startState;
+        if (acceptPrefix && accepting[state]) return true;
+
+        for (char c : name)
+        {
+            state = transitions[state * numClasses + byteClasses[static_cast<unsigned char>(c)]];
+
+            if (state == deadState) return false;
+            if (acceptPrefix && accepting[state]) return true;
+        }
+
+        return accepting[state];
+    }
+
+    /**
+    * Lowercased ASCII literal that every matching name contains ignoring ASCII case, empty if there is none
+    */
+    [[nodiscard]] const std::string& getRequiredLiteral() const { return requiredLiteral; }
+
+    [[nodiscard]] const std::string& getError() const { return error; }
+};
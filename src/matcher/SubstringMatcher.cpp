@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+// SSE2 is part of every x86-64 CPU
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define OGY_HAS_X86_SIMD
+#endif
+
+#include "CaseFoldingTable.h"
+#include "SubstringMatcher.h"
+#include "../utils/Utf8.h"
+
+namespace
+{
+    unsigned char toLowerAscii(unsigned char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c - 'A' + 'a') : c;
+    }
+
+    /**
+    * Whether the folded name has the folded term at `position`, skipping the first and last byte, which were already compared
+    */
+    bool hasTermAt(const unsigned char* name, size_t position, const unsigned char* term, size_t termLength)
+    {
+        for (size_t i = 1; i + 1 < termLength; i++)
+        {
+            if (toLowerAscii(name[position + i]) != term[i]) return false;
+        }
+        return true;
+    }
+
+    bool searchScalar(const unsigned char* name, size_t length, const unsigned char* term, size_t termLength)
+    {
+        const unsigned char first = term[0];
+        const unsigned char last = term[termLength - 1];
+
+        for (size_t i = 0; i + termLength <= length; i++)
+        {
+            if (toLowerAscii(name[i]) == first && toLowerAscii(name[i + termLength - 1]) == last && hasTermAt(name, i, term, termLength)) return true;
+        }
+        return false;
+    }
+
+#ifdef OGY_HAS_X86_SIMD
+    /**
+    * Lowercase the ASCII letters of 16 bytes. Adding 0x80 - 'A' moves 'A'...'Z' to the lowest 26 signed values, so one signed compare finds them
+    */
+    __m128i foldAscii(__m128i bytes)
+    {
+        const __m128i shifted = _mm_add_epi8(bytes, _mm_set1_epi8(static_cast<char>(0x80 - 'A')));
+        const __m128i upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(-128 + 26)));
+        return _mm_or_si128(bytes, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+    }
+
+    /**
+    * Compares the first and last term byte at 16 positions at once. `name` has to be readable up to 16 bytes past its end
+    */
+    bool searchSse2(const unsigned char* name, size_t length, const unsigned char* term, size_t termLength)
+    {
+        const __m128i first = _mm_set1_epi8(static_cast<char>(term[0]));
+        const __m128i last = _mm_set1_epi8(static_cast<char>(term[termLength - 1]));
+
+        for (size_t i = 0; i + termLength <= length; i += 16)
+        {
+            const __m128i firstBytes = foldAscii(_mm_loadu_si128(reinterpret_cast<const __m128i*>(name + i)));
+            const __m128i lastBytes = foldAscii(_mm_loadu_si128(reinterpret_cast<const __m128i*>(name + i + termLength - 1)));
+
+            // Positions past the last start compare the padding after the name with the last byte, which never matches
+            unsigned int candidates = static_cast<unsigned int>(_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(firstBytes, first), _mm_cmpeq_epi8(lastBytes, last))));
+
+            while (candidates != 0)
+            {
+                if (hasTermAt(name, i + __builtin_ctz(candidates), term, termLength)) return true;
+                candidates &= candidates - 1;
+            }
+        }
+        return false;
+    }
+
+    __attribute__((target("avx2"))) __m256i foldAsciiAvx2(__m256i bytes)
+    {
+        const __m256i shifted = _mm256_add_epi8(bytes, _mm256_set1_epi8(static_cast<char>(0x80 - 'A')));
+        const __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128 + 26)), shifted);
+        return _mm256_or_si256(bytes, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+    }
+
+    /**
+    * Same as searchSse2 with 32 positions at once. `name` has to be readable up to 32 bytes past its end
+    */
+    __attribute__((target("avx2"))) bool searchAvx2(const unsigned char* name, size_t length, const unsigned char* term, size_t termLength)
+    {
+        const __m256i first = _mm256_set1_epi8(static_cast<char>(term[0]));
+        const __m256i last = _mm256_set1_epi8(static_cast<char>(term[termLength - 1]));
+
+        for (size_t i = 0; i + termLength <= length; i += 32)
+        {
+            const __m256i firstBytes = foldAsciiAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(name + i)));
+            const __m256i lastBytes = foldAsciiAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(name + i + termLength - 1)));
+
+            unsigned int candidates = static_cast<unsigned int>(_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(firstBytes, first), _mm256_cmpeq_epi8(lastBytes, last))));
+
+            while (candidates != 0)
+            {
+                if (hasTermAt(name, i + __builtin_ctz(candidates), term, termLength)) return true;
+                candidates &= candidates - 1;
+            }
+        }
+        return false;
+    }
+#endif
+
+    /**
+    * Append the full case folding of a code point from Unicode's CaseFolding.txt (statuses C and F)
+    */
+    void foldCodePoint(uint32_t c, std::string& out)
+    {
+        if (c < 0x80)
+        {
+            out += static_cast<char>(toLowerAscii(static_cast<unsigned char>(c)));
+            return;
+        }
+
+        // Mappings to several characters, like 'ß' to "ss"
+        const auto* fullEnd = std::end(CaseFoldingTable::fullFoldings);
+        const auto* full = std::lower_bound(std::begin(CaseFoldingTable::fullFoldings), fullEnd, c,
+            [](const CaseFoldingTable::FullFolding& folding, uint32_t codePoint) {return folding.codePoint < codePoint;});
+
+        if (full != fullEnd && full->codePoint == c)
+        {
+            out += full->folded;
+            return;
+        }
+
+        // The last range starting at or before the code point
+        const auto* range = std::upper_bound(std::begin(CaseFoldingTable::ranges), std::end(CaseFoldingTable::ranges), c,
+            [](uint32_t codePoint, const CaseFoldingTable::Range& r) {return codePoint < r.first;});
+
+        uint32_t folded = c;
+        if (range != std::begin(CaseFoldingTable::ranges))
+        {
+            range--;
+            if (c <= range->last && (c - range->first) % range->stride == 0) folded = static_cast<uint32_t>(static_cast<int32_t>(c) + range->delta);
+        }
+
+        Utf8::append(out, folded);
+    }
+}
+
+SubstringMatcher::SubstringMatcher(std::string_view term)
+    : asciiOnlyTerm(false), search(getSearchFunction())
+{
+    foldUtf8(term, foldedTerm);
+
+    // Some other letters fold to ASCII ones, like 'ſ' to 's' or the Kelvin sign to 'k', so their terms are searched in ASCII names too
+    asciiOnlyTerm = isAscii(foldedTerm);
+    if (asciiOnlyTerm) asciiTerm = foldedTerm;
+}
+
+bool SubstringMatcher::matches(std::string_view name) const
+{
+    if (!isAscii(name))
+    {
+        // Reused by every name checked on the thread, so only the first long names allocate
+        thread_local std::string foldedName;
+        foldedName.clear();
+        foldUtf8(name, foldedName);
+
+        return foldedName.find(foldedTerm) != std::string::npos;
+    }
+
+    // Folding an ASCII name can't produce other bytes, so a term folded to other bytes can't be in it
+    if (!asciiOnlyTerm) return false;
+
+    const size_t termLength = asciiTerm.size();
+    if (termLength == 0) return true;
+    if (name.size() < termLength) return false;
+
+    const unsigned char* term = reinterpret_cast<const unsigned char*>(asciiTerm.data());
+
+    if (name.size() > maxSimdLength) return searchScalar(reinterpret_cast<const unsigned char*>(name.data()), name.size(), term, termLength);
+
+    // The blocks read past the end of the name, so it is copied in front of zeros, which no term byte equals
+    alignas(32) unsigned char padded[maxSimdLength + 64];
+    std::memcpy(padded, name.data(), name.size());
+    std::memset(padded + name.size(), 0, 64);
+
+    return search(padded, name.size(), term, termLength);
+}
+
+void SubstringMatcher::foldUtf8(std::string_view text, std::string& out)
+{
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(text.data());
+    const unsigned char* end = in + text.size();
+
+    while (in < end)
+    {
+        uint32_t codePoint;
+        const size_t length = Utf8::decode(in, static_cast<size_t>(end - in), codePoint);
+
+        if (length == 0)
+        {
+            out += static_cast<char>(*in++);
+            continue;
+        }
+
+        foldCodePoint(codePoint, out);
+        in += length;
+    }
+}
+
+bool SubstringMatcher::isAscii(std::string_view text)
+{
+    uint64_t highBits = 0;
+    size_t i = 0;
+
+    // 8 bytes at a time, which compilers turn into vector code
+    for (; i + 8 <= text.size(); i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, text.data() + i, sizeof(word));
+        highBits |= word;
+    }
+    for (; i < text.size(); i++) highBits |= static_cast<unsigned char>(text[i]);
+
+    return (highBits & 0x8080808080808080ull) == 0;
+}
+
+SubstringMatcher::SearchFunction SubstringMatcher::getSearchFunction()
+{
+#ifdef OGY_HAS_X86_SIMD
+    static const SearchFunction function = __builtin_cpu_supports("avx2") ? searchAvx2 : searchSse2;
+    return function;
+#else
+    return searchScalar;
+#endif
+}
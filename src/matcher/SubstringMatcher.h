@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+* Case-insensitive substring search for file names, compiled once per query and shared by all threads.
+*
+* Names with only ASCII bytes, which are most of them, are case folded and searched in the same pass with SSE2, or AVX2 if the
+* CPU has it: every position whose folded first and last bytes equal the term's is found 16 or 32 positions at a time, and only
+* those are compared in full. Nothing is allocated per name. Names with other bytes are decoded as UTF-8 and case folded per code
+* point with Unicode's full case folding (CaseFolding.txt, including mappings to several characters like 'ß' to "ss") before
+* searching, so "ÄRGER" contains "ärg".
+* Bytes which aren't valid UTF-8 are compared as they are
+*/
+class SubstringMatcher
+{
+public:
+    /**
+    * Longest name searched with SIMD. Longer names (which file names can't be on Linux) are searched with the scalar loop
+    */
+    static constexpr size_t maxSimdLength = 256;
+
+private:
+    using SearchFunction = bool (*)(const unsigned char* name, size_t length, const unsigned char* term, size_t termLength);
+
+    // The folded term if it only has ASCII bytes, used for ASCII names
+    std::string asciiTerm;
+    // The term case folded as UTF-8, used for all other names
+    std::string foldedTerm;
+    // Whether the folded term only has ASCII bytes
+    bool asciiOnlyTerm;
+    SearchFunction search;
+
+public:
+    explicit SubstringMatcher(std::string_view term);
+
+    /**
+    * Whether `name` contains the term, ignoring case
+    */
+    [[nodiscard]] bool matches(std::string_view name) const;
+
+    /**
+    * Whether the case folded term only has ASCII bytes. Only then the ASCII names containing it contain the ASCII term's bytes,
+    * ignoring ASCII case
+    */
+    [[nodiscard]] bool isAsciiTerm() const { return asciiOnlyTerm; }
+
+    /**
+    * The case folded term if isAsciiTerm(), otherwise empty
+    */
+    [[nodiscard]] const std::string& getAsciiTerm() const { return asciiTerm; }
+
+    /**
+    * Append `text` case folded to `out`. Exposed so other matchers fold names the same way
+    */
+    static void foldUtf8(std::string_view text, std::string& out);
+
+private:
+    static bool isAscii(std::string_view text);
+
+    /**
+    * The fastest search the CPU supports, checked once
+    */
+    static SearchFunction getSearchFunction();
+};
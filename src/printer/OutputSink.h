@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/**
+* Buffered writer for a file descriptor.
+* Output is collected in one large reusable buffer and written once it is full, at the latest when the sink is destroyed.
+* Strings which don't fit are written together with the buffered output in a single writev call instead of being copied.
+* Not thread-safe, output is only written from the main thread.
+*/
+class OutputSink
+{
+public:
+    static constexpr size_t defaultCapacity = 64 * 1024;
+
+private:
+    int fd;
+    size_t capacity;
+    size_t length = 0;
+    std::unique_ptr<char[]> buffer;
+
+public:
+    explicit OutputSink(int fd = STDOUT_FILENO, size_t capacity = defaultCapacity)
+        : fd(fd), capacity(capacity), buffer(std::make_unique<char[]>(capacity))
+    {
+    }
+
+    ~OutputSink()
+    {
+        flush();
+    }
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    /**
+    * Sink for stdout shared by the Printer and all commands
+    */
+    static OutputSink& getStdout()
+    {
+        static OutputSink sink(STDOUT_FILENO);
+        return sink;
+    }
+
+    void append(std::string_view str)
+    {
+        if (str.size() <= capacity - length)
+        {
+            std::memcpy(buffer.get() + length, str.data(), str.size());
+            length += str.size();
+            return;
+        }
+
+        if (str.size() < capacity)
+        {
+            flush();
+            std::memcpy(buffer.get(), str.data(), str.size());
+            length = str.size();
+            return;
+        }
+
+        // Too big to be worth buffering, so write it right after the buffered output
+        iovec chunks[2] = {
+            {buffer.get(), length},
+            {const_cast<char*>(str.data()), str.size()}
+        };
+        writeAll(chunks, 2);
+        length = 0;
+    }
+
+    void append(char c)
+    {
+        if (length == capacity) flush();
+        buffer[length++] = c;
+    }
+
+    /**
+    * Append `count` copies of `c`, e.g. spaces to pad a column
+    */
+    void appendRepeated(char c, size_t count)
+    {
+        while (count > 0)
+        {
+            if (length == capacity) flush();
+
+            size_t n = std::min(count, capacity - length);
+            std::memset(buffer.get() + length, c, n);
+            length += n;
+            count -= n;
+        }
+    }
+
+    void flush()
+    {
+        if (length == 0) return;
+
+        iovec chunk = {buffer.get(), length};
+        writeAll(&chunk, 1);
+        length = 0;
+    }
+
+private:
+    /**
+    * Write all chunks, continuing after partial writes and interruptions. Output is dropped on other errors (e.g. a closed pipe)
+    */
+    void writeAll(iovec* chunks, int numChunks)
+    {
+        while (numChunks > 0)
+        {
+            ssize_t written = ::writev(fd, chunks, numChunks);
+            if (written < 0)
+            {
+                if (errno == EINTR) continue;
+                return;
+            }
+
+            // Skip the chunks which were written completely and advance into the partially written one
+            while (numChunks > 0 && static_cast<size_t>(written) >= chunks->iov_len)
+            {
+                written -= chunks->iov_len;
+                chunks++;
+                numChunks--;
+            }
+
+            if (numChunks > 0)
+            {
+                chunks->iov_base = static_cast<char*>(chunks->iov_base) + written;
+                chunks->iov_len -= written;
+            }
+        }
+    }
+};
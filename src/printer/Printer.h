@@ -1,21 +1,131 @@
 #pragma once
 
-#include <ios>
-#include <iostream>
-#include <iomanip>
+#include <cstdlib>
 #include <string_view>
+#include <unistd.h>
 
+#include "OutputSink.h"
 #include "../formatter/Formatter.h"
 
 /**
-* Responsible for printing the output of commands
+* Responsible for printing the output of commands.
+* Everything goes through the buffered stdout sink, so nothing may be written to std::cout directly or the output would be reordered.
+* In plain mode (for pipelines) no escape sequences or padding are written and table cells are separated by tabs instead.
 */
 class Printer
 {
+private:
+    static constexpr int noStyle = -1;
+
+    // Style the terminal is currently set to, so consecutive cells with the same style don't repeat the escape sequence
+    inline static int currentStyle = noStyle;
+
+    inline static bool plain = false;
+    // Whether a table cell (printed with a width) has already been printed on the current line in plain mode
+    inline static bool inRow = false;
+
 public:
+    /**
+    * Plain output is used with `--plain`, when the NO_COLOR environment variable is set or when stdout isn't a terminal,
+    * unless the CLICOLOR_FORCE environment variable is set to something other than 0
+    */
+    static void setPlain(bool forcePlain)
+    {
+        plain = forcePlain || isEnvSet("NO_COLOR") || (!isatty(STDOUT_FILENO) && !isColorForced());
+    }
+
+    [[nodiscard]] static bool isPlain()
+    {
+        return plain;
+    }
+
     static void print(std::string_view str, int width, TextColor textColor, TextEmphasis textEmphasis)
     {
-        std::cout << std::left << "\033[" << std::setw(0) << Formatter::emphasesToStringMapping[textEmphasis] << ";" 
-        << Formatter::colorsToStringMapping[textColor] << "m" << std::setw(width) << std::setfill(' ') << str << "\033[0m";
+        OutputSink& sink = OutputSink::getStdout();
+
+        if (plain)
+        {
+            printPlain(sink, str, width);
+            return;
+        }
+
+        const int style = Formatter::getStyleIndex(textColor, textEmphasis);
+        if (style != currentStyle)
+        {
+            sink.append(Formatter::getStyle(textColor, textEmphasis));
+            currentStyle = style;
+        }
+
+        sink.append(str);
+        // Left aligned and padded with spaces up to `width`, like std::setw
+        if (width > 0 && static_cast<size_t>(width) > str.size()) sink.appendRepeated(' ', width - str.size());
+    }
+
+    /**
+    * Print unformatted text, e.g. `Printer::write("Error: ", strerror(errno), "\n")`
+    */
+    template<typename... Parts>
+    static void write(const Parts&... parts)
+    {
+        resetStyle();
+        inRow = false;
+
+        OutputSink& sink = OutputSink::getStdout();
+        (sink.append(std::string_view(parts)), ...);
+    }
+
+    static void newLine()
+    {
+        resetStyle();
+        inRow = false;
+        OutputSink::getStdout().append('\n');
+    }
+
+    static void flush()
+    {
+        resetStyle();
+        OutputSink::getStdout().flush();
+    }
+
+private:
+    static bool isEnvSet(const char* name)
+    {
+        const char* value = std::getenv(name);
+        return value != nullptr && *value != '\0';
+    }
+
+    static bool isColorForced()
+    {
+        const char* value = std::getenv("CLICOLOR_FORCE");
+        return isEnvSet("CLICOLOR_FORCE") && std::string_view(value) != "0";
+    }
+
+    /**
+    * Cells printed with a width are table cells, which get a tab separator instead of padding.
+    * Blank cells (only used as spacers) become empty fields, so every row keeps the same number of fields
+    */
+    static void printPlain(OutputSink& sink, std::string_view str, int width)
+    {
+        if (width <= 0)
+        {
+            sink.append(str);
+            return;
+        }
+
+        if (inRow) sink.append('\t');
+        inRow = true;
+
+        if (str.find_first_not_of(' ') != std::string_view::npos) sink.append(str);
+    }
+
+    /**
+    * Styles are only reset before unformatted text, line breaks and when flushing, not after every cell
+    */
+    static void resetStyle()
+    {
+        if (currentStyle == noStyle) return;
+
+        OutputSink::getStdout().append(Formatter::reset);
+        currentStyle = noStyle;
     }
 };
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "OutputSink.h"
+#include "rapidjson/writer.h"
+#include "../utils/Utf8.h"
+
+/**
+* Output formats selected with the global `--format=` flag. TABLE is the default, human readable output
+*/
+enum class OutputFormat
+{
+    TABLE,
+    JSONL,
+    CSV,
+    TSV,
+    NUL
+};
+
+/**
+* Streams records of named fields into the stdout sink, one record per line.
+* JSON Lines records are written with rapidjson, with bytes of values that aren't valid UTF-8 replaced by U+FFFD, CSV (RFC 4180 quoting) and TSV (backslash escapes) by hand.
+* NUL-delimited output has no fields and is written by the caller.
+*/
+class RecordWriter
+{
+private:
+    /**
+    * rapidjson output stream writing straight into the sink, so no intermediate string buffer is needed
+    */
+    struct SinkStream
+    {
+        typedef char Ch;
+
+        OutputSink* sink;
+
+        void Put(char c) { sink->append(c); }
+        void Flush() {}
+    };
+
+    OutputFormat format;
+    OutputSink& sink;
+    SinkStream stream;
+    // Validating makes sure no invalid UTF-8 is written, even if a value is passed without being replaced
+    rapidjson::Writer<SinkStream, rapidjson::UTF8<>, rapidjson::UTF8<>, rapidjson::CrtAllocator, rapidjson::kWriteValidateEncodingFlag> jsonWriter;
+    // Copy of a value with its invalid bytes replaced, reused for every value
+    std::string validValue;
+    bool firstField = true;
+
+public:
+    explicit RecordWriter(OutputFormat format)
+        : format(format), sink(OutputSink::getStdout()), stream{&sink}, jsonWriter(stream)
+    {
+    }
+
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    /**
+    * Column names for CSV and TSV. Nothing is written for other formats
+    */
+    void writeHeader(const std::vector<std::string_view>& keys)
+    {
+        if (format != OutputFormat::CSV && format != OutputFormat::TSV) return;
+
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (i > 0) sink.append(separator());
+            writeDelimitedValue(keys[i]);
+        }
+        sink.append('\n');
+    }
+
+    void beginRecord()
+    {
+        firstField = true;
+        if (format == OutputFormat::JSONL) jsonWriter.StartObject();
+    }
+
+    void addField(std::string_view key, std::string_view value)
+    {
+        if (format == OutputFormat::JSONL)
+        {
+            // File names can have any bytes but '/' and NUL on Linux
+            if (!Utf8::isValid(value))
+            {
+                validValue.clear();
+                Utf8::appendValid(validValue, value);
+                value = validValue;
+            }
+
+            jsonWriter.Key(key.data(), static_cast<rapidjson::SizeType>(key.size()));
+            jsonWriter.String(value.data(), static_cast<rapidjson::SizeType>(value.size()));
+            return;
+        }
+
+        addDelimitedField(value);
+    }
+
+    /**
+    * Same as addField, but written as a JSON number. `value` has to be a valid number
+    */
+    void addNumber(std::string_view key, std::string_view value)
+    {
+        if (format == OutputFormat::JSONL)
+        {
+            jsonWriter.Key(key.data(), static_cast<rapidjson::SizeType>(key.size()));
+            jsonWriter.RawValue(value.data(), value.size(), rapidjson::kNumberType);
+            return;
+        }
+
+        addDelimitedField(value);
+    }
+
+    void endRecord()
+    {
+        if (format == OutputFormat::JSONL)
+        {
+            jsonWriter.EndObject();
+            // Every line is a complete JSON document, so the writer has to be reset for the next one
+            jsonWriter.Reset(stream);
+        }
+
+        sink.append('\n');
+    }
+
+private:
+    char separator() const
+    {
+        return format == OutputFormat::CSV ? ',' : '\t';
+    }
+
+    void addDelimitedField(std::string_view value)
+    {
+        if (!firstField) sink.append(separator());
+        firstField = false;
+
+        writeDelimitedValue(value);
+    }
+
+    void writeDelimitedValue(std::string_view value)
+    {
+        if (format == OutputFormat::CSV)
+        {
+            if (value.find_first_of(",\"\r\n") == std::string_view::npos)
+            {
+                sink.append(value);
+                return;
+            }
+
+            // Quote the value and double the quotes inside it
+            sink.append('"');
+            for (char c : value)
+            {
+                if (c == '"') sink.append('"');
+                sink.append(c);
+            }
+            sink.append('"');
+            return;
+        }
+
+        if (value.find_first_of("\t\r\n\\") == std::string_view::npos)
+        {
+            sink.append(value);
+            return;
+        }
+
+        for (char c : value)
+        {
+            switch (c)
+            {
+                case '\t': sink.append("\\t"); break;
+                case '\r': sink.append("\\r"); break;
+                case '\n': sink.append("\\n"); break;
+                case '\\': sink.append("\\\\"); break;
+                default: sink.append(c);
+            }
+        }
+    }
+};
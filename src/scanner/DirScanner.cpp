@@ -0,0 +1,191 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "DirScanner.h"
+
+#ifdef __linux__
+/**
+* Layout of the records returned by the getdents64 syscall
+*/
+struct LinuxDirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+#endif
+
+DirScanner::DirScanner(size_t bufferSize)
+    : buffer(bufferSize)
+{
+}
+
+DirScanner::~DirScanner()
+{
+    close();
+}
+
+DirScanner::DirScanner(DirScanner&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+DirScanner& DirScanner::operator=(DirScanner&& other) noexcept
+{
+    if (this == &other) return *this;
+
+    close();
+
+    fd = other.fd;
+    error = other.error;
+    buffer = std::move(other.buffer);
+    bufferPos = other.bufferPos;
+    bufferEnd = other.bufferEnd;
+    endReached = other.endReached;
+    other.fd = -1;
+
+#ifndef __linux__
+    dir = other.dir;
+    other.dir = nullptr;
+#endif
+
+    return *this;
+}
+
+bool DirScanner::open(const char* path)
+{
+    return openAt(AT_FDCWD, path);
+}
+
+bool DirScanner::openAt(int dirFd, const char* name)
+{
+    close();
+
+    int newFd = ::openat(dirFd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (newFd < 0)
+    {
+        error = errno;
+        return false;
+    }
+
+    return assign(newFd);
+}
+
+bool DirScanner::assign(int dirFd)
+{
+    close();
+
+    fd = dirFd;
+
+#ifndef __linux__
+    dir = ::fdopendir(fd);
+    if (dir == nullptr)
+    {
+        error = errno;
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+#endif
+
+    error = 0;
+    bufferPos = 0;
+    bufferEnd = 0;
+    endReached = false;
+
+    return true;
+}
+
+void DirScanner::close()
+{
+#ifndef __linux__
+    // closedir also closes the underlying file descriptor
+    if (dir != nullptr)
+    {
+        ::closedir(dir);
+        dir = nullptr;
+        fd = -1;
+    }
+#endif
+
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool DirScanner::next(DirEntry& entry)
+{
+#ifdef __linux__
+    while (true)
+    {
+        if (bufferPos >= bufferEnd && !refill()) return false;
+
+        auto* record = reinterpret_cast<LinuxDirent64*>(buffer.data() + bufferPos);
+        bufferPos += record->d_reclen;
+
+        const char* name = record->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+        entry.name = std::string_view(name, std::strlen(name));
+        entry.type = record->d_type;
+        entry.inode = record->d_ino;
+
+        return true;
+    }
+#else
+    if (dir == nullptr) return false;
+
+    while (true)
+    {
+        errno = 0;
+        dirent* record = ::readdir(dir);
+        if (record == nullptr)
+        {
+            error = errno;
+            return false;
+        }
+
+        const char* name = record->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+        entry.name = std::string_view(name, std::strlen(name));
+        entry.type = record->d_type;
+        entry.inode = record->d_ino;
+
+        return true;
+    }
+#endif
+}
+
+bool DirScanner::refill()
+{
+#ifdef __linux__
+    if (fd < 0 || endReached) return false;
+
+    long numBytes = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+    if (numBytes <= 0)
+    {
+        if (numBytes < 0) error = errno;
+        endReached = true;
+        return false;
+    }
+
+    bufferPos = 0;
+    bufferEnd = static_cast<size_t>(numBytes);
+
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include <dirent.h>
+#include <sys/types.h>
+
+/**
+* A single entry of a directory. The name points into the scanner's buffer and is only valid until the next call to DirScanner::next()
+*/
+struct DirEntry
+{
+    std::string_view name;
+    unsigned char type; // DT_* value, DT_UNKNOWN if the file system doesn't report the type
+    ino_t inode;
+};
+
+/**
+* Reads the entries of a directory in large batches into a reusable buffer.
+* Uses getdents64 on Linux and falls back to readdir on other systems. The `.` and `..` entries are skipped.
+*/
+class DirScanner
+{
+public:
+    static constexpr size_t defaultBufferSize = 64 * 1024;
+
+    explicit DirScanner(size_t bufferSize = defaultBufferSize);
+    ~DirScanner();
+
+    DirScanner(const DirScanner&) = delete;
+    DirScanner& operator=(const DirScanner&) = delete;
+    DirScanner(DirScanner&& other) noexcept;
+    DirScanner& operator=(DirScanner&& other) noexcept;
+
+    /**
+    * Open the directory at `path` (relative to the current working directory if not absolute)
+    */
+    bool open(const char* path);
+
+    /**
+    * Open the directory `name` relative to the open directory `dirFd`
+    */
+    bool openAt(int dirFd, const char* name);
+
+    /**
+    * Take ownership of an already opened directory descriptor
+    */
+    bool assign(int dirFd);
+
+    void close();
+
+    /**
+    * Get the next entry of the directory. Returns false once all entries have been read or an error occurred
+    */
+    bool next(DirEntry& entry);
+
+    [[nodiscard]] bool isOpen() const { return fd >= 0; }
+    [[nodiscard]] int getFd() const { return fd; }
+    /**
+    * errno of the last failed operation or 0
+    */
+    [[nodiscard]] int getError() const { return error; }
+
+private:
+    bool refill();
+
+    int fd = -1;
+    int error = 0;
+    std::vector<char> buffer;
+    size_t bufferPos = 0;
+    size_t bufferEnd = 0;
+    bool endReached = false;
+
+#ifndef __linux__
+    DIR* dir = nullptr;
+#endif
+};
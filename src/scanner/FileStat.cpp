@@ -0,0 +1,80 @@
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "FileStat.h"
+
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+#define OGY_HAS_STATX 1
+#endif
+
+#ifdef __APPLE__
+#define st_mtim st_mtimespec
+#endif
+
+static bool fstatAtFallback(int dirFd, const char* name, FileStat& fileStat, bool followSymlinks)
+{
+    struct stat st;
+    if (fstatat(dirFd, name, &st, followSymlinks ? 0 : AT_SYMLINK_NOFOLLOW) != 0) return false;
+
+    fileStat.mode = st.st_mode;
+    fileStat.numLinks = st.st_nlink;
+    fileStat.uid = st.st_uid;
+    fileStat.gid = st.st_gid;
+    fileStat.size = st.st_size;
+    fileStat.blocks = st.st_blocks;
+    fileStat.lastModified = st.st_mtim.tv_sec;
+
+    return true;
+}
+
+#ifdef OGY_HAS_STATX
+static unsigned int toStatxMask(unsigned int fields)
+{
+    unsigned int mask = 0;
+
+    if (fields & STAT_TYPE) mask |= STATX_TYPE;
+    if (fields & STAT_MODE) mask |= STATX_MODE;
+    if (fields & STAT_NLINK) mask |= STATX_NLINK;
+    if (fields & STAT_UID) mask |= STATX_UID;
+    if (fields & STAT_GID) mask |= STATX_GID;
+    if (fields & STAT_SIZE) mask |= STATX_SIZE;
+    if (fields & STAT_BLOCKS) mask |= STATX_BLOCKS;
+    if (fields & STAT_MTIME) mask |= STATX_MTIME;
+
+    return mask;
+}
+#endif
+
+bool statAt(int dirFd, const char* name, unsigned int fields, FileStat& fileStat, bool followSymlinks)
+{
+#ifdef OGY_HAS_STATX
+    // Cleared once the kernel turns out to not support statx
+    static std::atomic<bool> hasStatx = true;
+
+    if (hasStatx.load(std::memory_order_relaxed))
+    {
+        struct statx stx;
+        int flags = AT_STATX_SYNC_AS_STAT | (followSymlinks ? 0 : AT_SYMLINK_NOFOLLOW);
+
+        if (statx(dirFd, name, flags, toStatxMask(fields), &stx) == 0)
+        {
+            fileStat.mode = stx.stx_mode;
+            fileStat.numLinks = stx.stx_nlink;
+            fileStat.uid = stx.stx_uid;
+            fileStat.gid = stx.stx_gid;
+            fileStat.size = static_cast<off_t>(stx.stx_size);
+            fileStat.blocks = static_cast<blkcnt_t>(stx.stx_blocks);
+            fileStat.lastModified = stx.stx_mtime.tv_sec;
+
+            return true;
+        }
+
+        if (errno != ENOSYS) return false;
+        hasStatx.store(false, std::memory_order_relaxed);
+    }
+#endif
+
+    return fstatAtFallback(dirFd, name, fileStat, followSymlinks);
+}
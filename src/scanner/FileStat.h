@@ -0,0 +1,42 @@
+#pragma once
+
+#include <ctime>
+#include <sys/types.h>
+
+/**
+* Metadata fields that can be requested from statAt(). Only the requested fields are guaranteed to be set
+*/
+enum StatField : unsigned int
+{
+    STAT_TYPE = 1 << 0,
+    STAT_MODE = 1 << 1,
+    STAT_NLINK = 1 << 2,
+    STAT_UID = 1 << 3,
+    STAT_GID = 1 << 4,
+    STAT_SIZE = 1 << 5,
+    STAT_BLOCKS = 1 << 6,
+    STAT_MTIME = 1 << 7,
+    STAT_ALL = (1 << 8) - 1
+};
+
+/**
+* The subset of a file's metadata used by the commands
+*/
+struct FileStat
+{
+    mode_t mode = 0; // File type and permission bits
+    nlink_t numLinks = 0;
+    uid_t uid = 0;
+    gid_t gid = 0;
+    off_t size = 0;
+    blkcnt_t blocks = 0;
+    time_t lastModified = 0;
+};
+
+/**
+* Get the metadata of `name` relative to the open directory `dirFd`.
+* On Linux statx() is used and only the requested fields are asked for, which lets the kernel skip
+* expensive attribute revalidation on network and FUSE mounts. Symlinks are not followed unless `followSymlinks` is set.
+* Returns false and sets errno on failure
+*/
+bool statAt(int dirFd, const char* name, unsigned int fields, FileStat& fileStat, bool followSymlinks = false);
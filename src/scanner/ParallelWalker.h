@@ -0,0 +1,259 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "DirScanner.h"
+#include "FileStat.h"
+#include "TreeWalker.h"
+#include "../utils/ThreadPool.h"
+
+/**
+* Parallel traversal of one or more directory trees on the ThreadPool.
+* Every worker owns a deque of directories waiting to be scanned: it pushes the subdirectories it finds to the back and
+* takes work from the back as well, while idle workers steal from the front of the other deques, which holds the directories
+* closest to the root and therefore the biggest chunks of work.
+* The walk ends once no directory is queued or being scanned, which is tracked with a single counter updated once per directory.
+* Symlinks to directories are not followed and the order in which entries are visited is not deterministic.
+*/
+class ParallelWalker
+{
+public:
+    // Directories queued with an already opened descriptor, beyond which they are reopened from their path
+    static constexpr int defaultMaxQueuedFds = 256;
+
+private:
+    struct DirTask
+    {
+        int fd = -1; // Opened relative to the parent directory, or -1 if it has to be opened from `path`
+        std::string path;
+        int depth = 0;
+        size_t root = 0;
+    };
+
+    struct alignas(64) Worker
+    {
+        std::mutex mutex;
+        std::deque<DirTask> tasks;
+    };
+
+    ThreadPool& threadPool;
+    int numWorkers;
+    int maxQueuedFds;
+    std::unique_ptr<Worker[]> workers;
+
+    int baseFd = AT_FDCWD;
+    // Directories which are queued or being scanned
+    std::atomic<size_t> numPendingDirs = 0;
+    std::atomic<size_t> numQueuedDirs = 0;
+    std::atomic<int> numQueuedFds = 0;
+
+    std::mutex parkMutex;
+    std::condition_variable parkCv;
+    std::atomic<int> numParked = 0;
+
+public:
+    explicit ParallelWalker(ThreadPool& threadPool, int maxQueuedFds = defaultMaxQueuedFds)
+        : threadPool(threadPool), numWorkers(threadPool.getNumThreads()), maxQueuedFds(maxQueuedFds),
+        workers(std::make_unique<Worker[]>(numWorkers))
+    {
+    }
+
+    ParallelWalker(const ParallelWalker&) = delete;
+    ParallelWalker& operator=(const ParallelWalker&) = delete;
+
+    /**
+    * Number of workers. Visitors get the index of the worker calling them, so they can keep per-worker state without locking
+    */
+    [[nodiscard]] int getNumWorkers() const
+    {
+        return numWorkers;
+    }
+
+    /**
+    * Call `visitor(int worker, const WalkEntry& entry)` for every entry below `root`. Blocks until the whole tree has been visited
+    */
+    template <typename Visitor>
+    void walk(std::string_view root, Visitor&& visitor)
+    {
+        walkAt(AT_FDCWD, {std::string(root)}, std::forward<Visitor>(visitor));
+    }
+
+    /**
+    * Same as walk() for several roots opened relative to `dirFd`. `WalkEntry::root` is the index of the entry's root in `roots`
+    */
+    template <typename Visitor>
+    void walkAt(int dirFd, const std::vector<std::string>& roots, Visitor&& visitor)
+    {
+        baseFd = dirFd;
+
+        for (size_t i = 0; i < roots.size(); i++)
+        {
+            DirTask task;
+            task.path = roots[i].empty() ? "." : roots[i];
+            task.root = i;
+            push(static_cast<int>(i % numWorkers), std::move(task));
+        }
+
+        std::vector<std::future<void>> results;
+        for (int i = 0; i < numWorkers; i++)
+        {
+            results.emplace_back(threadPool.addTask([this, i, &visitor]() {runWorker(i, visitor);}));
+        }
+
+        for (auto& result : results) result.get();
+    }
+
+private:
+    void push(int self, DirTask&& task)
+    {
+        numPendingDirs.fetch_add(1, std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> lg(workers[self].mutex);
+            workers[self].tasks.emplace_back(std::move(task));
+        }
+
+        numQueuedDirs.fetch_add(1, std::memory_order_release);
+        if (numParked.load(std::memory_order_relaxed) > 0) parkCv.notify_one();
+    }
+
+    bool popLocal(int self, DirTask& task)
+    {
+        Worker& worker = workers[self];
+        std::lock_guard<std::mutex> lg(worker.mutex);
+        if (worker.tasks.empty()) return false;
+
+        task = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+        numQueuedDirs.fetch_sub(1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    bool steal(int self, DirTask& task)
+    {
+        for (int i = 1; i < numWorkers; i++)
+        {
+            Worker& victim = workers[(self + i) % numWorkers];
+            std::lock_guard<std::mutex> lg(victim.mutex);
+            if (victim.tasks.empty()) continue;
+
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            numQueuedDirs.fetch_sub(1, std::memory_order_relaxed);
+
+            return true;
+        }
+
+        return false;
+    }
+
+    template <typename Visitor>
+    void runWorker(int self, Visitor& visitor)
+    {
+        DirScanner scanner;
+        std::string path;
+        DirTask task;
+
+        while (true)
+        {
+            if (popLocal(self, task) || steal(self, task))
+            {
+                scanDirectory(self, task, scanner, path, visitor);
+
+                // The last directory has been scanned, so no new work can appear anymore
+                if (numPendingDirs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    std::lock_guard<std::mutex> lg(parkMutex);
+                    parkCv.notify_all();
+                }
+                continue;
+            }
+
+            if (numPendingDirs.load(std::memory_order_acquire) == 0) return;
+
+            // Wait for new work. The timeout covers a notification arriving between the checks above and the wait
+            std::unique_lock<std::mutex> ul(parkMutex);
+            numParked.fetch_add(1, std::memory_order_relaxed);
+            parkCv.wait_for(ul, std::chrono::milliseconds(1), [this]() {
+                return numQueuedDirs.load(std::memory_order_acquire) > 0 || numPendingDirs.load(std::memory_order_acquire) == 0;
+            });
+            numParked.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    template <typename Visitor>
+    void scanDirectory(int self, DirTask& task, DirScanner& scanner, std::string& path, Visitor& visitor)
+    {
+        if (task.fd >= 0)
+        {
+            numQueuedFds.fetch_sub(1, std::memory_order_relaxed);
+            if (!scanner.assign(task.fd)) return;
+        }
+        else if (!scanner.openAt(baseFd, task.path.c_str()))
+        {
+            return;
+        }
+
+        const int dirFd = scanner.getFd();
+        path.assign(task.path);
+        if (path.back() != '/') path += '/';
+        const size_t prefixLength = path.size();
+
+        DirEntry entry;
+        while (scanner.next(entry))
+        {
+            path.resize(prefixLength);
+            path.append(entry.name);
+
+            unsigned char type = entry.type;
+            if (type == DT_UNKNOWN)
+            {
+                FileStat fileStat;
+                if (statAt(dirFd, entry.name.data(), STAT_TYPE, fileStat)) type = S_ISDIR(fileStat.mode) ? DT_DIR : DT_REG;
+            }
+
+            WalkEntry walkEntry{entry.name, path, type, entry.inode, task.depth, dirFd};
+            walkEntry.root = task.root;
+            visitor(self, static_cast<const WalkEntry&>(walkEntry));
+
+            if (type != DT_DIR) continue;
+
+            DirTask child;
+            child.path = path;
+            child.depth = task.depth + 1;
+            child.root = task.root;
+
+            // Open the subdirectory relative to this one while the number of queued descriptors allows it
+            if (numQueuedFds.fetch_add(1, std::memory_order_relaxed) < maxQueuedFds)
+            {
+                child.fd = ::openat(dirFd, entry.name.data(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+                if (child.fd < 0)
+                {
+                    numQueuedFds.fetch_sub(1, std::memory_order_relaxed);
+                    continue;
+                }
+            }
+            else
+            {
+                numQueuedFds.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            push(self, std::move(child));
+        }
+
+        scanner.close();
+    }
+};
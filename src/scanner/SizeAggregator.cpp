@@ -0,0 +1,62 @@
+#include "SizeAggregator.h"
+#include "FileStat.h"
+#include "ParallelWalker.h"
+#include "TreeWalker.h"
+#include "../utils/ThreadPool.h"
+
+namespace
+{
+    off_t walkDirectory(TreeWalker& walker, int parentFd, const std::string& dirName)
+    {
+        off_t totalSize = 0;
+
+        walker.walkAt(parentFd, dirName, [&totalSize](const WalkEntry& entry) {
+            FileStat fileStat;
+
+            // Skip entries that disappeared or can't be accessed
+            if (!statAt(entry.dirFd, entry.name.data(), STAT_SIZE | STAT_BLOCKS, fileStat)) return;
+
+            totalSize += fileStat.size;
+        });
+
+        return totalSize;
+    }
+}
+
+std::vector<off_t> SizeAggregator::aggregate(int parentFd, const std::vector<std::string>& dirNames, ThreadPool* threadPool)
+{
+    std::vector<off_t> dirSizes(dirNames.size(), 0);
+
+    if (threadPool == nullptr)
+    {
+        TreeWalker walker;
+
+        for (size_t i = 0; i < dirNames.size(); i++)
+        {
+            dirSizes[i] = walkDirectory(walker, parentFd, dirNames[i]);
+        }
+
+        return dirSizes;
+    }
+
+    // Subtrees are split between the workers at directory granularity, so every worker keeps its own total per root
+    // which are merged once the walk is done
+    ParallelWalker walker(*threadPool);
+    std::vector<std::vector<off_t>> workerTotals(walker.getNumWorkers(), std::vector<off_t>(dirNames.size(), 0));
+
+    walker.walkAt(parentFd, dirNames, [&workerTotals](int worker, const WalkEntry& entry) {
+        FileStat fileStat;
+
+        // Skip entries that disappeared or can't be accessed
+        if (!statAt(entry.dirFd, entry.name.data(), STAT_SIZE | STAT_BLOCKS, fileStat)) return;
+
+        workerTotals[worker][entry.root] += fileStat.size;
+    });
+
+    for (const auto& totals : workerTotals)
+    {
+        for (size_t i = 0; i < totals.size(); i++) dirSizes[i] += totals[i];
+    }
+
+    return dirSizes;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+class ThreadPool;
+
+/**
+* Computes the total size of several directories below a common parent in a single traversal of their subtrees
+*/
+class SizeAggregator
+{
+public:
+    /**
+    * Get the total size of everything below each directory in `dirNames`, which are opened relative to `parentFd`.
+    * The totals are returned in the same order as the names. If a thread pool is passed, the subtrees are walked in parallel with a ParallelWalker
+    */
+    static std::vector<off_t> aggregate(int parentFd, const std::vector<std::string>& dirNames, ThreadPool* threadPool = nullptr);
+};
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "DirScanner.h"
+#include "FileStat.h"
+
+/**
+* An entry visited by the TreeWalker. The views are only valid during the visitor call.
+* `name` and `path` are always null-terminated, so `fstatat(dirFd, name.data(), ...)` can be used to get the entry's info
+* without the kernel resolving the full path again
+*/
+struct WalkEntry
+{
+    std::string_view name;
+    std::string_view path;
+    unsigned char type;
+    ino_t inode;
+    int depth;
+    int dirFd; // Open file descriptor of the directory containing the entry
+    size_t root = 0; // Index of the root the entry was found under when walking several roots
+};
+
+/**
+* Depth-first, pre-order traversal of a directory tree built on DirScanner.
+* Keeps one open file descriptor per directory level so every lookup is relative to the parent directory.
+* At most `maxOpenFds` descriptors are kept open: once the limit is reached, the remaining entries of the shallowest
+* open level are read into memory and its descriptor is closed, to be reopened when the walk returns to it.
+* The scanners and buffers are reused between walks, so walking doesn't allocate per entry. Symlinks to directories are not followed.
+*/
+class TreeWalker
+{
+public:
+    static constexpr int defaultMaxOpenFds = 64;
+
+private:
+    struct Level
+    {
+        DirScanner scanner;
+        // Descriptor used for *at() calls once the scanner was closed and the directory had to be reopened
+        int reopenedFd = -1;
+
+        // Entries that were read ahead when the level was evicted (type, inode, null-terminated name)
+        std::string spilled;
+        size_t spilledPos = 0;
+        bool isSpilled = false;
+
+        size_t prefixLength = 0;
+
+        int getFd() const { return scanner.isOpen() ? scanner.getFd() : reopenedFd; }
+        bool hasFd() const { return getFd() >= 0; }
+    };
+
+    std::vector<Level> levels;
+    std::string path;
+    int rootDirFd = AT_FDCWD;
+    int maxOpenFds;
+    int numOpenFds = 0;
+
+public:
+    explicit TreeWalker(int maxOpenFds = defaultMaxOpenFds)
+        : maxOpenFds(maxOpenFds < 2 ? 2 : maxOpenFds)
+    {
+    }
+
+    ~TreeWalker()
+    {
+        for (auto& level : levels) closeLevel(level);
+    }
+
+    TreeWalker(const TreeWalker&) = delete;
+    TreeWalker& operator=(const TreeWalker&) = delete;
+
+    /**
+    * Call `visitor(const WalkEntry&)` for every entry below `root`, before descending into it
+    */
+    template <typename Visitor>
+    void walk(std::string_view root, Visitor&& visitor)
+    {
+        walkAt(AT_FDCWD, root, std::forward<Visitor>(visitor));
+    }
+
+    /**
+    * Same as walk(), with `root` opened relative to the open directory `dirFd`
+    */
+    template <typename Visitor>
+    void walkAt(int dirFd, std::string_view root, Visitor&& visitor)
+    {
+        path.assign(root);
+        if (path.empty()) path = ".";
+        rootDirFd = dirFd;
+
+        if (levels.empty()) levels.emplace_back();
+        if (!levels[0].scanner.openAt(dirFd, path.c_str())) return;
+        numOpenFds = 1;
+
+        if (path.back() != '/') path += '/';
+        levels[0].prefixLength = path.size();
+
+        int depth = 0;
+        DirEntry entry;
+
+        while (depth >= 0)
+        {
+            // Grow before reading the entry, since its name might point into the level's memory
+            if (levels.size() <= static_cast<size_t>(depth + 1)) levels.emplace_back();
+            Level& level = levels[depth];
+
+            if (!nextEntry(level, entry))
+            {
+                closeLevel(level);
+                depth--;
+
+                if (depth >= 0 && !levels[depth].hasFd() && !reopenLevel(depth))
+                {
+                    // The directory can't be accessed anymore, so skip the rest of its entries
+                    closeLevel(levels[depth]);
+                    depth--;
+                }
+                continue;
+            }
+
+            const int dirFd = level.getFd();
+            path.resize(level.prefixLength);
+            path.append(entry.name);
+
+            unsigned char type = entry.type == DT_UNKNOWN ? resolveType(dirFd, entry.name.data()) : entry.type;
+
+            visitor(WalkEntry{entry.name, path, type, entry.inode, depth, dirFd});
+
+            if (type != DT_DIR) continue;
+
+            if (numOpenFds >= maxOpenFds) evictShallowestLevel(depth);
+
+            Level& child = levels[depth + 1];
+            if (!child.scanner.openAt(dirFd, entry.name.data())) continue;
+
+            numOpenFds++;
+            depth++;
+            path += '/';
+            child.prefixLength = path.size();
+        }
+    }
+
+private:
+    bool nextEntry(Level& level, DirEntry& entry)
+    {
+        if (!level.isSpilled) return level.scanner.next(entry);
+
+        if (level.spilledPos >= level.spilled.size()) return false;
+
+        const char* record = level.spilled.data() + level.spilledPos;
+        entry.type = static_cast<unsigned char>(record[0]);
+        std::memcpy(&entry.inode, record + 1, sizeof(ino_t));
+
+        const char* name = record + 1 + sizeof(ino_t);
+        size_t nameLength = std::strlen(name);
+        entry.name = std::string_view(name, nameLength);
+        level.spilledPos += 1 + sizeof(ino_t) + nameLength + 1;
+
+        return true;
+    }
+
+    /**
+    * Read the remaining entries of the shallowest level that still has an open descriptor into memory and close it
+    */
+    void evictShallowestLevel(int currentDepth)
+    {
+        for (int i = 0; i < currentDepth; i++)
+        {
+            Level& level = levels[i];
+            if (!level.hasFd()) continue;
+
+            if (!level.isSpilled)
+            {
+                level.spilled.clear();
+                level.spilledPos = 0;
+
+                DirEntry entry;
+                while (level.scanner.next(entry))
+                {
+                    level.spilled += static_cast<char>(entry.type);
+                    level.spilled.append(reinterpret_cast<const char*>(&entry.inode), sizeof(ino_t));
+                    level.spilled.append(entry.name);
+                    level.spilled += '\0';
+                }
+
+                level.isSpilled = true;
+            }
+
+            closeFds(level);
+            return;
+        }
+    }
+
+    /**
+    * Open the directory of an evicted level again. All deeper levels are closed at this point
+    */
+    bool reopenLevel(int depth)
+    {
+        Level& level = levels[depth];
+
+        // The prefix ends with '/', which is fine for opening a directory
+        path.resize(level.prefixLength);
+        level.reopenedFd = ::openat(rootDirFd, path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if (level.reopenedFd < 0) return false;
+
+        numOpenFds++;
+        return true;
+    }
+
+    void closeFds(Level& level)
+    {
+        if (level.scanner.isOpen())
+        {
+            level.scanner.close();
+            numOpenFds--;
+        }
+        if (level.reopenedFd >= 0)
+        {
+            ::close(level.reopenedFd);
+            level.reopenedFd = -1;
+            numOpenFds--;
+        }
+    }
+
+    void closeLevel(Level& level)
+    {
+        closeFds(level);
+        level.isSpilled = false;
+        level.spilled.clear();
+        level.spilledPos = 0;
+    }
+
+    static unsigned char resolveType(int dirFd, const char* name)
+    {
+        FileStat fileStat;
+        if (!statAt(dirFd, name, STAT_TYPE, fileStat)) return DT_UNKNOWN;
+
+        return S_ISDIR(fileStat.mode) ? DT_DIR : DT_REG;
+    }
+};
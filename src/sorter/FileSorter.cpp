@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <limits>
+
+#include "FileSorter.h"
+#include "../utils/ParallelSort.h"
+
+namespace
+{
+    // Written in front of a run of digits. Digits are never written as they are, so the marker only ever meets another marker
+    constexpr char digitsMarker = '0';
+    // Separates the parts of a key. Lower than every byte of a name, so shorter parts sort first
+    constexpr char keySeparator = '\0';
+
+    bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    char toLower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    /**
+    * Extension of a file name without the dot. Names starting with their only dot (hidden files) have none
+    */
+    std::string_view getExtension(std::string_view name)
+    {
+        const size_t dot = name.rfind('.');
+        if (dot == std::string_view::npos || dot == 0) return std::string_view();
+
+        return name.substr(dot + 1);
+    }
+
+    /**
+    * First 8 bytes of the key as a big-endian number, so comparing the numbers is the same as comparing the bytes
+    */
+    uint64_t getPrefix(std::string_view key)
+    {
+        uint64_t prefix = 0;
+
+        for (size_t i = 0; i < sizeof(prefix); i++)
+        {
+            prefix <<= 8;
+            if (i < key.size()) prefix |= static_cast<unsigned char>(key[i]);
+        }
+
+        return prefix;
+    }
+}
+
+FileSorter::FileSorter(SortMode mode, bool reverse)
+    : mode(mode), reverse(reverse)
+{
+}
+
+void FileSorter::reserve(size_t numFiles)
+{
+    records.reserve(numFiles);
+}
+
+void FileSorter::add(std::string_view name, off_t size, time_t lastModified)
+{
+    SortRecord record;
+    record.primary = getPrimaryKey(mode, size, lastModified);
+    record.index = static_cast<uint32_t>(records.size());
+
+    record.keyOffset = static_cast<uint32_t>(keys.size());
+    appendNameKey(name);
+    record.keyLength = static_cast<uint32_t>(keys.size() - record.keyOffset);
+    record.namePrefix = getPrefix(std::string_view(keys.data() + record.keyOffset, record.keyLength));
+
+    records.emplace_back(record);
+}
+
+uint64_t FileSorter::getPrimaryKey(SortMode mode, off_t size, time_t lastModified)
+{
+    // Largest and newest first, like `ls -S` and `ls -t`
+    if (mode == SortMode::SIZE) return std::numeric_limits<uint64_t>::max() - static_cast<uint64_t>(std::max<off_t>(size, 0));
+
+    // Flipping the sign bit orders negative times before positive ones
+    if (mode == SortMode::MTIME) return ~(static_cast<uint64_t>(lastModified) ^ (uint64_t(1) << 63));
+
+    return 0;
+}
+
+std::vector<uint32_t> FileSorter::sort(ThreadPool* threadPool)
+{
+    ParallelSort::sort(records, [this](const SortRecord& a, const SortRecord& b) {return isBefore(a, b);}, threadPool);
+
+    std::vector<uint32_t> order;
+    order.reserve(records.size());
+
+    for (const auto& record : records) order.emplace_back(record.index);
+    if (reverse) std::reverse(order.begin(), order.end());
+
+    return order;
+}
+
+void FileSorter::appendNameKey(std::string_view name)
+{
+    if (mode == SortMode::EXT)
+    {
+        for (char c : getExtension(name)) keys += toLower(c);
+        keys += keySeparator;
+    }
+
+    for (size_t i = 0; i < name.size();)
+    {
+        if (!isDigit(name[i]))
+        {
+            keys += toLower(name[i]);
+            i++;
+            continue;
+        }
+
+        size_t end = i;
+        while (end < name.size() && isDigit(name[end])) end++;
+
+        // Leading zeros don't change the number, but keep one digit for a run of zeros
+        size_t start = i;
+        while (start + 1 < end && name[start] == '0') start++;
+
+        // A longer number is a bigger one. Numbers with more than 255 digits are only ordered by their first digits
+        keys += digitsMarker;
+        keys += static_cast<char>(std::min<size_t>(end - start, 255));
+        keys.append(name, start, end - start);
+
+        i = end;
+    }
+
+    keys += keySeparator;
+    keys.append(name);
+}
+
+bool FileSorter::isBefore(const SortRecord& a, const SortRecord& b) const
+{
+    if (a.primary != b.primary) return a.primary < b.primary;
+    if (a.namePrefix != b.namePrefix) return a.namePrefix < b.namePrefix;
+
+    if (a.keyLength > sizeof(a.namePrefix) || b.keyLength > sizeof(b.namePrefix))
+    {
+        const int result = std::string_view(keys.data() + a.keyOffset, a.keyLength).compare(std::string_view(keys.data() + b.keyOffset, b.keyLength));
+        if (result != 0) return result < 0;
+    }
+
+    return a.index < b.index;
+}
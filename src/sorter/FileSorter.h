@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+
+class ThreadPool;
+
+/**
+* Sort orders selected with the global `--sort=` flag. NONE keeps the order in which the files were found
+*/
+enum class SortMode
+{
+    NONE,
+    SIZE,
+    MTIME,
+    NAME,
+    EXT
+};
+
+/**
+* Sorts files by a key computed once per file, instead of comparing names or metadata on every comparison.
+* Files are added in their original order and `sort` returns that order's indices in sorted order.
+* Size and modification time sort the largest/newest first, names and extensions in natural order (e.g. "file2" before "file10"), case-insensitively.
+* Ties are broken by the name and then by the original order
+*/
+class FileSorter
+{
+private:
+    /**
+    * Compact record of a file which is moved around while sorting. `primary` is the size or time and `namePrefix`
+    * the first bytes of the name key, so most comparisons don't need to look at the key buffer at all
+    */
+    struct SortRecord
+    {
+        uint64_t primary;
+        uint64_t namePrefix;
+        uint32_t keyOffset;
+        uint32_t keyLength;
+        uint32_t index;
+    };
+
+    SortMode mode;
+    bool reverse;
+    std::vector<SortRecord> records;
+    // Name keys of all files, see appendNameKey
+    std::string keys;
+
+public:
+    FileSorter(SortMode mode, bool reverse);
+
+    void reserve(size_t numFiles);
+
+    /**
+    * Add the next file. Its index is the number of files added before it
+    */
+    void add(std::string_view name, off_t size, time_t lastModified);
+
+    /**
+    * Key of a file for sorting by size or modification time. Smaller keys are the larger or newer files, which are sorted first
+    */
+    static uint64_t getPrimaryKey(SortMode mode, off_t size, time_t lastModified);
+
+    /**
+    * Get the indices of the added files in sorted order. Sorts in parallel if a thread pool is passed and there are enough files
+    */
+    std::vector<uint32_t> sort(ThreadPool* threadPool);
+
+private:
+    /**
+    * Append a key for `name` to the key buffer whose byte order is the natural order of the names:
+    * letters are lowercased and every run of digits is written as a marker, the number of digits without leading zeros and the digits.
+    * For extensions the lowercased extension comes first. The original name is appended after a null byte as a tie breaker
+    */
+    void appendNameKey(std::string_view name);
+
+    bool isBefore(const SortRecord& a, const SortRecord& b) const;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+* Keeps the `limit` items with the smallest keys pushed so far, e.g. FileSorter::getPrimaryKey keys to keep the largest or newest files.
+* The kept items are a max-heap, so an item which can't make it is rejected with a single comparison against the root.
+* Memory is bounded by the limit, no matter how many items are pushed. Not thread-safe, every worker keeps its own heap and they are merged at the end
+*/
+template<typename T>
+class TopHeap
+{
+private:
+    struct Entry
+    {
+        uint64_t key;
+        T item;
+    };
+
+    size_t limit;
+    std::vector<Entry> entries;
+
+public:
+    explicit TopHeap(size_t limit)
+        : limit(limit)
+    {
+    }
+
+    /**
+    * Whether an item with the key would be kept. Lets callers skip building items which would be thrown away right away
+    */
+    bool wouldKeep(uint64_t key) const
+    {
+        if (entries.size() < limit) return true;
+        return limit > 0 && key < entries.front().key;
+    }
+
+    void push(uint64_t key, T item)
+    {
+        if (!wouldKeep(key)) return;
+
+        if (entries.size() == limit)
+        {
+            std::pop_heap(entries.begin(), entries.end(), isBefore);
+            entries.pop_back();
+        }
+
+        entries.push_back(Entry{key, std::move(item)});
+        std::push_heap(entries.begin(), entries.end(), isBefore);
+    }
+
+    /**
+    * Move the items of another heap, e.g. one of another worker, into this one
+    */
+    void merge(TopHeap&& other)
+    {
+        for (auto& entry : other.entries) push(entry.key, std::move(entry.item));
+        other.entries.clear();
+    }
+
+    /**
+    * Take the kept items out of the heap, in no particular order
+    */
+    std::vector<T> take()
+    {
+        std::vector<T> items;
+        items.reserve(entries.size());
+
+        for (auto& entry : entries) items.emplace_back(std::move(entry.item));
+        entries.clear();
+
+        return items;
+    }
+
+private:
+    static bool isBefore(const Entry& a, const Entry& b)
+    {
+        return a.key < b.key;
+    }
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <utility>
+
+/**
+* Lock-free bounded multi-producer multi-consumer queue (Dmitry Vyukov's ring buffer).
+* Every cell holds a sequence number telling producers and consumers whether it is free for the current lap,
+* so an operation only needs one compare-and-swap on the shared position. Cells and positions are kept on separate cache lines.
+* The capacity is rounded up to a power of two.
+*/
+template<typename T>
+class BoundedQueue
+{
+private:
+    static constexpr size_t cacheLineSize = 64;
+
+    struct alignas(cacheLineSize) Cell
+    {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* item() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    size_t capacity;
+    size_t mask;
+    std::unique_ptr<Cell[]> cells;
+
+    alignas(cacheLineSize) std::atomic<size_t> enqueuePos = 0;
+    alignas(cacheLineSize) std::atomic<size_t> dequeuePos = 0;
+
+public:
+    explicit BoundedQueue(size_t minCapacity = 1024)
+    {
+        capacity = 2;
+        while (capacity < minCapacity) capacity <<= 1;
+
+        mask = capacity - 1;
+        cells = std::make_unique<Cell[]>(capacity);
+
+        for (size_t i = 0; i < capacity; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    ~BoundedQueue()
+    {
+        while (tryDequeue().has_value()) {}
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+    * Returns false if the queue is full. The item is only moved from on success
+    */
+    bool tryEnqueue(T&& item)
+    {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+            if (diff == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    new (cell.storage) T(std::move(item));
+                    // Hand the cell over to the consumers of this lap
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                // Full
+                return false;
+            }
+            else
+            {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryEnqueue(const T& item)
+    {
+        T copy = item;
+        return tryEnqueue(std::move(copy));
+    }
+
+    std::optional<T> tryDequeue()
+    {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+
+            if (diff == 0)
+            {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    std::optional<T> result(std::move(*cell.item()));
+                    cell.item()->~T();
+                    // Free the cell for the producers of the next lap
+                    cell.sequence.store(pos + capacity, std::memory_order_release);
+
+                    return result;
+                }
+            }
+            else if (diff < 0)
+            {
+                // Empty
+                return std::nullopt;
+            }
+            else
+            {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+    * Wait until there is space for the item
+    */
+    void enqueue(T&& item)
+    {
+        for (int attempt = 0; !tryEnqueue(std::move(item)); attempt++) backoff(attempt);
+    }
+
+    /**
+    * Wait until an item is available
+    */
+    T dequeue()
+    {
+        for (int attempt = 0; ; attempt++)
+        {
+            if (auto item = tryDequeue(); item.has_value()) return std::move(item.value());
+            backoff(attempt);
+        }
+    }
+
+    /**
+    * Only a snapshot, since other threads might be changing the queue at the same time
+    */
+    [[nodiscard]] size_t size() const
+    {
+        size_t enqueued = enqueuePos.load(std::memory_order_relaxed);
+        size_t dequeued = dequeuePos.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    [[nodiscard]] bool isEmpty() const
+    {
+        return size() == 0;
+    }
+
+    [[nodiscard]] size_t getCapacity() const
+    {
+        return capacity;
+    }
+
+private:
+    // Spin for a while before giving up the time slice, since the other side usually only needs a few instructions
+    static void backoff(int attempt)
+    {
+        if (attempt < 64) return;
+        std::this_thread::yield();
+    }
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+/**
+* Number of CPUs the process can actually use, which in a container is often much lower than std::thread::hardware_concurrency().
+* Takes the minimum of the CPU affinity mask and the cgroup CPU quota (cgroup v2 `cpu.max`, or v1 `cpu.cfs_quota_us`/`cpu.cfs_period_us`).
+*/
+class CpuCount
+{
+public:
+    // Environment variable overriding the number of worker threads
+    static constexpr const char* threadsEnvVariable = "OGY_THREADS";
+
+    /**
+    * Parse a positive thread count, returning 0 if `value` isn't one
+    */
+    static int parseThreadCount(const char* value)
+    {
+        if (value == nullptr || *value == '\0') return 0;
+
+        char* end = nullptr;
+        long count = std::strtol(value, &end, 10);
+        if (*end != '\0' || count <= 0 || count > 4096) return 0;
+
+        return static_cast<int>(count);
+    }
+
+    /**
+    * CPUs available for `quota` microseconds of CPU time per `period`, rounded up. 0 if there's no limit
+    */
+    static int quotaToCpus(double quota, double period)
+    {
+        if (quota <= 0 || period <= 0) return 0;
+        return std::max(1, static_cast<int>(std::ceil(quota / period)));
+    }
+
+    /**
+    * Path of the process' cgroup for `controller` from /proc/self/cgroup (or `procCgroupFile`), or the v2 (unified) cgroup if
+    * `controller` is empty
+    */
+    static bool getCgroupPath(const std::string& controller, std::string& path, const std::string& procCgroupFile = "/proc/self/cgroup")
+    {
+        std::ifstream file(procCgroupFile);
+        std::string line;
+
+        // Lines look like `hierarchy-id:controller-list:path`, where the v2 hierarchy is `0::path`
+        while (std::getline(file, line))
+        {
+            size_t first = line.find(':');
+            size_t second = line.find(':', first + 1);
+            if (first == std::string::npos || second == std::string::npos) continue;
+
+            std::string controllers = line.substr(first + 1, second - first - 1);
+            bool matches = controller.empty() ? controllers.empty() : ("," + controllers + ",").find("," + controller + ",") != std::string::npos;
+            if (!matches) continue;
+
+            path = line.substr(second + 1);
+            return true;
+        }
+
+        return false;
+    }
+
+    /**
+    * CPUs allowed by a cgroup v2 `cpu.max` file (`quota period`, or `max period` if unlimited). 0 if there's no limit
+    */
+    static int readCpuMax(const std::string& fileName)
+    {
+        std::ifstream file(fileName);
+        std::string quota;
+        double period = 0;
+
+        if (!(file >> quota >> period) || quota == "max") return 0;
+        return quotaToCpus(std::atof(quota.c_str()), period);
+    }
+
+    /**
+    * Limit from cgroup v2 `cpu.max` below `cgroupRoot`, where the unified hierarchy is mounted. A limit can be set on any
+    * ancestor, so the whole path up to the root is checked
+    */
+    static int getCgroupV2Limit(const std::string& cgroupRoot = "/sys/fs/cgroup", const std::string& procCgroupFile = "/proc/self/cgroup")
+    {
+        std::string path;
+        if (!getCgroupPath("", path, procCgroupFile)) return 0;
+
+        int limit = 0;
+        auto addLimit = [&limit](int cpus) {
+            if (cpus > 0) limit = limit == 0 ? cpus : std::min(limit, cpus);
+        };
+
+        while (!path.empty() && path != "/")
+        {
+            addLimit(readCpuMax(cgroupRoot + path + "/cpu.max"));
+
+            size_t parent = path.rfind('/');
+            path = parent == 0 || parent == std::string::npos ? "/" : path.substr(0, parent);
+        }
+
+        // Inside a container the container's own cgroup is usually mounted as the root, so the path from /proc/self/cgroup
+        // (which may be relative to the host's root) doesn't exist below it and the limit is in the root's `cpu.max`
+        addLimit(readCpuMax(cgroupRoot + "/cpu.max"));
+
+        return limit;
+    }
+
+    /**
+    * Limit from cgroup v1 `cpu.cfs_quota_us` (-1 if unlimited) and `cpu.cfs_period_us`
+    */
+    static int getCgroupV1Limit()
+    {
+        std::string path;
+        if (!getCgroupPath("cpu", path)) return 0;
+
+        // Inside a container the cgroup is usually mounted as the root, so the host path from /proc/self/cgroup doesn't exist
+        for (const std::string& mount : {std::string("/sys/fs/cgroup/cpu"), std::string("/sys/fs/cgroup/cpu,cpuacct")})
+        {
+            for (const std::string& dir : {mount + path, mount})
+            {
+                std::ifstream quotaFile(dir + "/cpu.cfs_quota_us");
+                std::ifstream periodFile(dir + "/cpu.cfs_period_us");
+                double quota = 0;
+                double period = 0;
+
+                if (quotaFile >> quota && periodFile >> period) return quotaToCpus(quota, period);
+            }
+        }
+
+        return 0;
+    }
+
+    static int getAffinityCpus()
+    {
+#ifdef __linux__
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0) return CPU_COUNT(&cpus);
+#endif
+        return 0;
+    }
+
+    /**
+    * Detected once, since the limits don't change while ogy runs
+    */
+    static int getAvailableCpus()
+    {
+        static const int availableCpus = []() {
+            int cpus = static_cast<int>(std::thread::hardware_concurrency());
+
+            int affinity = getAffinityCpus();
+            if (affinity > 0) cpus = cpus > 0 ? std::min(cpus, affinity) : affinity;
+
+#ifdef __linux__
+            int quota = getCgroupV2Limit();
+            if (quota == 0) quota = getCgroupV1Limit();
+            if (quota > 0) cpus = cpus > 0 ? std::min(cpus, quota) : quota;
+#endif
+
+            return std::max(cpus, 1);
+        }();
+
+        return availableCpus;
+    }
+
+    /**
+    * Default number of worker threads: `OGY_THREADS` if it's set to a valid count, otherwise the number of available CPUs
+    */
+    static int getDefaultNumThreads()
+    {
+        int fromEnv = parseThreadCount(std::getenv(threadsEnvVariable));
+        return fromEnv > 0 ? fromEnv : getAvailableCpus();
+    }
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cerrno>
+#include <grp.h>
+#include <mutex>
+#include <pwd.h>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+/**
+* Process-wide cache of user and group names, so every distinct id is only looked up once.
+* Lookups can be slow when NSS is backed by a directory service (e.g. LDAP), and a listing usually only has a few distinct owners.
+* Safe to use from multiple threads. The returned names stay valid until the process exits.
+*/
+class IdNameCache
+{
+private:
+    template<typename Id>
+    struct Cache
+    {
+        std::shared_mutex mutex;
+        // Node based, so the names don't move when the map grows
+        std::unordered_map<Id, std::string> names;
+    };
+
+public:
+    /**
+    * Name of the user with the id, or "-" if there is none
+    */
+    static std::string_view getUserName(uid_t uid)
+    {
+        static Cache<uid_t> cache;
+        // Consecutive files mostly have the same owner, which then doesn't even need the shared lock
+        thread_local uid_t lastUid = 0;
+        thread_local std::string_view lastName;
+
+        if (!lastName.empty() && lastUid == uid) return lastName;
+
+        lastName = lookup(cache, uid, resolveUserName);
+        lastUid = uid;
+
+        return lastName;
+    }
+
+    /**
+    * Name of the group with the id, or "-" if there is none
+    */
+    static std::string_view getGroupName(gid_t gid)
+    {
+        static Cache<gid_t> cache;
+        thread_local gid_t lastGid = 0;
+        thread_local std::string_view lastName;
+
+        if (!lastName.empty() && lastGid == gid) return lastName;
+
+        lastName = lookup(cache, gid, resolveGroupName);
+        lastGid = gid;
+
+        return lastName;
+    }
+
+private:
+    template<typename Id, typename Resolve>
+    static std::string_view lookup(Cache<Id>& cache, Id id, Resolve resolve)
+    {
+        {
+            std::shared_lock<std::shared_mutex> sl(cache.mutex);
+            auto it = cache.names.find(id);
+            if (it != cache.names.end()) return it->second;
+        }
+
+        // Resolved without holding the lock. If another thread resolved the same id meanwhile, its name is kept
+        std::string name = resolve(id);
+
+        std::unique_lock<std::shared_mutex> ul(cache.mutex);
+        return cache.names.try_emplace(id, std::move(name)).first->second;
+    }
+
+    static size_t getInitialBufferSize(int sysconfName)
+    {
+        long size = sysconf(sysconfName);
+        return size > 0 ? static_cast<size_t>(size) : 1024;
+    }
+
+    static std::string resolveUserName(uid_t uid)
+    {
+        std::vector<char> buffer(getInitialBufferSize(_SC_GETPW_R_SIZE_MAX));
+        passwd pwd;
+        passwd* result = nullptr;
+        int error;
+
+        // The buffer has to be grown if an entry doesn't fit
+        while ((error = getpwuid_r(uid, &pwd, buffer.data(), buffer.size(), &result)) == ERANGE) buffer.resize(buffer.size() * 2);
+
+        if (error != 0 || result == nullptr) return "-";
+        return result->pw_name;
+    }
+
+    static std::string resolveGroupName(gid_t gid)
+    {
+        std::vector<char> buffer(getInitialBufferSize(_SC_GETGR_R_SIZE_MAX));
+        group grp;
+        group* result = nullptr;
+        int error;
+
+        while ((error = getgrgid_r(gid, &grp, buffer.data(), buffer.size(), &result)) == ERANGE) buffer.resize(buffer.size() * 2);
+
+        if (error != 0 || result == nullptr) return "-";
+        return result->gr_name;
+    }
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "WaitGroup.h"
+
+/**
+* Stable sort which splits the items into one run per thread of a ThreadPool, sorts the runs in parallel and combines them with a k-way merge
+*/
+class ParallelSort
+{
+public:
+    // Below this many items the threads cost more than they save
+    static constexpr size_t minParallelItems = 1 << 15;
+
+    /**
+    * Sort `items` with `less`. Sorts on the calling thread if no thread pool is passed or there are too few items
+    */
+    template<typename T, typename Less>
+    static void sort(std::vector<T>& items, Less less, ThreadPool* threadPool)
+    {
+        const size_t numRuns = threadPool ? static_cast<size_t>(threadPool->getNumThreads()) : 1;
+
+        if (numRuns < 2 || items.size() < minParallelItems)
+        {
+            std::stable_sort(items.begin(), items.end(), less);
+            return;
+        }
+
+        std::vector<size_t> runStarts(numRuns + 1);
+        for (size_t run = 0; run <= numRuns; run++) runStarts[run] = items.size() * run / numRuns;
+
+        WaitGroup pendingRuns(static_cast<int>(numRuns));
+
+        for (size_t run = 0; run < numRuns; run++)
+        {
+            auto first = items.begin() + runStarts[run];
+            auto last = items.begin() + runStarts[run + 1];
+
+            threadPool->submit([first, last, &less, &pendingRuns]() {
+                std::stable_sort(first, last, less);
+                pendingRuns.done();
+            });
+        }
+
+        pendingRuns.wait();
+
+        items = merge(items, runStarts, less);
+    }
+
+private:
+    /**
+    * Merge the sorted runs of `items` which start at `runStarts`. On equal items the one from the earlier run is taken first, which keeps the sort stable
+    */
+    template<typename T, typename Less>
+    static std::vector<T> merge(std::vector<T>& items, const std::vector<size_t>& runStarts, Less& less)
+    {
+        // Position in `items` and the run it belongs to
+        using Head = std::pair<size_t, size_t>;
+
+        auto isAfter = [&](const Head& a, const Head& b) {
+            if (less(items[b.first], items[a.first])) return true;
+            if (less(items[a.first], items[b.first])) return false;
+            return a.second > b.second;
+        };
+
+        std::priority_queue<Head, std::vector<Head>, decltype(isAfter)> heads(isAfter);
+
+        for (size_t run = 0; run + 1 < runStarts.size(); run++)
+        {
+            if (runStarts[run] < runStarts[run + 1]) heads.emplace(runStarts[run], run);
+        }
+
+        std::vector<T> merged;
+        merged.reserve(items.size());
+
+        while (!heads.empty())
+        {
+            const auto [pos, run] = heads.top();
+            heads.pop();
+
+            merged.emplace_back(std::move(items[pos]));
+            if (pos + 1 < runStarts[run + 1]) heads.emplace(pos + 1, run);
+        }
+
+        return merged;
+    }
+};
@@ -1,29 +1,38 @@
+#pragma once
+
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
 #include <mutex>
 #include <optional>
 #include <queue>
 #include <stdexcept>
+#include "BoundedQueue.h"
 
-template<typename T>
+/**
+* Thread-safe queue. The default backend is an unbounded std::queue behind a mutex,
+* SafeQueue<T, BoundedQueue<T>> uses the lock-free bounded queue instead (see the specialization below).
+*/
+template<typename T, typename Backend = std::queue<T>>
 class SafeQueue
 {
 private:
-    std::queue<T> queue;
+    Backend queue;
     mutable std::mutex queueMutex;
     std::condition_variable cvQueue;
     std::atomic<bool> enabled = true;
 
 public:
     SafeQueue() = default;
-    SafeQueue(SafeQueue<T>& safeQueue) = delete;
-    SafeQueue& operator=(SafeQueue<T>& safeQueue) = delete;
+    SafeQueue(SafeQueue& safeQueue) = delete;
+    SafeQueue& operator=(SafeQueue& safeQueue) = delete;
     ~SafeQueue() {};
 
     void enqueue(T&& item)
     {
         std::unique_lock<std::mutex> lg(queueMutex);
-        queue.push(item);
+        queue.push(std::move(item));
         cvQueue.notify_one();
     }
 
@@ -39,7 +48,22 @@ public:
         if (!enabled && queue.empty())
             return std::nullopt;
         
-        T temp = queue.front();
+        T temp = std::move(queue.front());
+        queue.pop();
+        return std::optional(std::move(temp));
+    }
+
+    /**
+    * Same as dequeue, but returns std::nullopt instead of waiting when the queue is empty
+    */
+    std::optional<T> tryDequeue()
+    {
+        std::unique_lock<std::mutex> ul(queueMutex);
+
+        if (queue.empty())
+            return std::nullopt;
+
+        T temp = std::move(queue.front());
         queue.pop();
         return std::optional(std::move(temp));
     }
@@ -62,3 +86,101 @@ public:
         cvQueue.notify_all();
     }
 };
+
+/**
+* Lock-free backend for contended producers and consumers. Enqueueing waits while the queue is full,
+* dequeue() spins briefly and then parks on a condition variable until an item arrives or the queue is closed.
+*/
+template<typename T>
+class SafeQueue<T, BoundedQueue<T>>
+{
+private:
+    BoundedQueue<T> queue;
+    std::atomic<bool> enabled = true;
+
+    std::mutex parkMutex;
+    std::condition_variable parkCv;
+    std::atomic<int> numParked = 0;
+
+public:
+    explicit SafeQueue(size_t capacity = 1024)
+        : queue(capacity)
+    {
+    }
+
+    SafeQueue(SafeQueue& safeQueue) = delete;
+    SafeQueue& operator=(SafeQueue& safeQueue) = delete;
+    ~SafeQueue() {};
+
+    void enqueue(T&& item)
+    {
+        queue.enqueue(std::move(item));
+        wakeConsumer();
+    }
+
+    /**
+    * Same as enqueue, but returns false instead of waiting when the queue is full
+    */
+    bool tryEnqueue(T&& item)
+    {
+        if (!queue.tryEnqueue(std::move(item))) return false;
+
+        wakeConsumer();
+        return true;
+    }
+
+    std::optional<T> dequeue()
+    {
+        for (int attempt = 0; ; attempt++)
+        {
+            if (auto item = queue.tryDequeue(); item.has_value()) return item;
+            if (!enabled) return queue.tryDequeue();
+
+            if (attempt < 64) continue;
+
+            // The timeout covers an item arriving between the check above and the wait
+            std::unique_lock<std::mutex> ul(parkMutex);
+            numParked.fetch_add(1, std::memory_order_seq_cst);
+            parkCv.wait_for(ul, std::chrono::milliseconds(1), [this]() {
+                return !queue.isEmpty() || !enabled;
+            });
+            numParked.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+    * Same as dequeue, but returns std::nullopt instead of waiting when the queue is empty
+    */
+    std::optional<T> tryDequeue()
+    {
+        return queue.tryDequeue();
+    }
+
+    [[nodiscard]] bool isEmpty() const
+    {
+        return queue.isEmpty();
+    }
+
+    [[nodiscard]] unsigned int size() const
+    {
+        return queue.size();
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lg(parkMutex);
+            enabled = false;
+        }
+        parkCv.notify_all();
+    }
+
+private:
+    void wakeConsumer()
+    {
+        if (numParked.load(std::memory_order_seq_cst) == 0) return;
+
+        std::lock_guard<std::mutex> lg(parkMutex);
+        parkCv.notify_one();
+    }
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+* Move-only type-erased `void()` callable.
+* Callables which fit in the inline buffer (e.g. lambdas capturing a handful of references or indices) are stored in place,
+* so creating a task doesn't touch the allocator. Bigger callables fall back to the heap.
+*/
+class Task
+{
+public:
+    static constexpr size_t inlineSize = 56;
+
+private:
+    struct Operations
+    {
+        void (*invoke)(void* storage);
+        // Move construct into `destination` and destroy the source
+        void (*relocate)(void* destination, void* source);
+        void (*destroy)(void* storage);
+    };
+
+    template<typename Func>
+    static constexpr bool isInline = sizeof(Func) <= inlineSize && alignof(Func) <= alignof(std::max_align_t)
+        && std::is_nothrow_move_constructible_v<Func>;
+
+    template<typename Func>
+    static constexpr Operations inlineOperations = {
+        [](void* storage) {(*std::launder(static_cast<Func*>(storage)))();},
+        [](void* destination, void* source) {
+            Func* func = std::launder(static_cast<Func*>(source));
+            new (destination) Func(std::move(*func));
+            func->~Func();
+        },
+        [](void* storage) {std::launder(static_cast<Func*>(storage))->~Func();}
+    };
+
+    template<typename Func>
+    static constexpr Operations heapOperations = {
+        [](void* storage) {(**static_cast<Func**>(storage))();},
+        [](void* destination, void* source) {*static_cast<Func**>(destination) = *static_cast<Func**>(source);},
+        [](void* storage) {delete *static_cast<Func**>(storage);}
+    };
+
+    alignas(std::max_align_t) unsigned char storage[inlineSize];
+    const Operations* operations = nullptr;
+
+public:
+    Task() = default;
+
+    template<typename Func, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Func>, Task>>>
+    Task(Func&& f)
+    {
+        using Callable = std::decay_t<Func>;
+
+        if constexpr (isInline<Callable>)
+        {
+            new (storage) Callable(std::forward<Func>(f));
+            operations = &inlineOperations<Callable>;
+        }
+        else
+        {
+            new (storage) Callable*(new Callable(std::forward<Func>(f)));
+            operations = &heapOperations<Callable>;
+        }
+    }
+
+    Task(Task&& other) noexcept
+    {
+        moveFrom(other);
+    }
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            moveFrom(other);
+        }
+
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task()
+    {
+        reset();
+    }
+
+    void operator()()
+    {
+        operations->invoke(storage);
+    }
+
+    explicit operator bool() const
+    {
+        return operations != nullptr;
+    }
+
+    /**
+    * Destroy the stored callable, leaving the task empty
+    */
+    void reset()
+    {
+        if (operations == nullptr) return;
+
+        operations->destroy(storage);
+        operations = nullptr;
+    }
+
+private:
+    void moveFrom(Task& other)
+    {
+        if (other.operations == nullptr) return;
+
+        other.operations->relocate(storage, other.storage);
+        operations = other.operations;
+        other.operations = nullptr;
+    }
+};
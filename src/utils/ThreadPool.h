@@ -6,79 +6,224 @@
 #include <exception>
 #include <functional>
 #include <future>
+#include <iostream>
 #include <memory>
 #include <mutex>
+#include "BoundedQueue.h"
+#include "CpuCount.h"
 #include "SafeQueue.h"
+#include "Task.h"
+#include "WorkStealingDeque.h"
 #include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+/**
+* Work-stealing thread pool.
+* Tasks added from a worker thread go to that worker's own deque, tasks added from other threads go to a shared injection queue.
+* Idle workers take work from their own deque first, then from the injection queue, then steal from the other workers.
+* Workers which find no work park on a condition variable and are woken up when new tasks are added.
+* Finished task nodes are recycled through a free list, so submitting a task whose callable fits in Task's inline buffer doesn't allocate.
+*/
 class ThreadPool
 {
 private:
-    int numThreads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+    static constexpr size_t injectionQueueCapacity = 4096;
+    static constexpr size_t freeTasksCapacity = 4096;
+
+    struct Worker
+    {
+        WorkStealingDeque<Task*> tasks;
+    };
+
+    /**
+    * Identifies the pool and worker the current thread belongs to, so addTask can push to the worker's own deque
+    */
+    struct WorkerContext
+    {
+        ThreadPool* pool = nullptr;
+        int index = -1;
+    };
+
+    static thread_local WorkerContext currentWorker;
+
+    int numThreads;
     std::vector<std::thread> threads;
+    std::unique_ptr<Worker[]> workers;
     std::atomic<bool> enabled = true;
-    SafeQueue<std::function<void()>> tasks;
+    // Lock-free, since every thread outside the pool and every idle worker polls it. Adding a task waits while it is full
+    SafeQueue<Task*, BoundedQueue<Task*>> injectedTasks{injectionQueueCapacity};
     std::atomic<int> numPendingTasks = 0;
+    BoundedQueue<Task*> freeTasks{freeTasksCapacity};
+
+    // Tasks which are queued but not taken by a worker yet
+    std::atomic<int64_t> numQueuedTasks = 0;
+    std::atomic<int> numParked = 0;
+    std::mutex parkMutex;
+    std::condition_variable parkCv;
 
 public:
-    ThreadPool()
+    /**
+    * With `requestedThreads` <= 0 the pool uses `OGY_THREADS` or the number of CPUs available to the process (see CpuCount)
+    */
+    explicit ThreadPool(int requestedThreads = 0)
+        : numThreads(requestedThreads > 0 ? requestedThreads : CpuCount::getDefaultNumThreads())
     {
+        workers = std::make_unique<Worker[]>(numThreads);
+
         try
         {
-            for (uint8_t i = 0; i < numThreads; i++)
+            for (int i = 0; i < numThreads; i++)
             {
-                threads.emplace_back(std::thread(&ThreadPool::worker, this));
+                threads.emplace_back(std::thread(&ThreadPool::worker, this, i));
             }
         }
         catch(const std::exception& e)
         {
-            enabled = false;
-            joinThreads();
+            shutdown();
             std::cerr << e.what() << '\n';
         }
     }
 
     ~ThreadPool()
     {
-        enabled = false;
-        tasks.close();
-        joinThreads();
+        shutdown();
     }
 
     template<typename Func, typename... Args>
     auto addTask(Func&& f, Args&&... args)
     {
-        using ReturnType = typename std::invoke_result_t<Func>;
-        
-        auto task = std::make_shared<std::packaged_task<ReturnType()>>(std::bind(std::forward<Func>(f), std::forward<Args>(args)...));
-        std::future<ReturnType> resultFuture = task->get_future();
+        using ReturnType = typename std::invoke_result_t<Func, Args...>;
 
-        tasks.enqueue([task](){(*task)();});
-        numPendingTasks++;
+        std::packaged_task<ReturnType()> task(std::bind(std::forward<Func>(f), std::forward<Args>(args)...));
+        std::future<ReturnType> resultFuture = task.get_future();
+
+        submit(std::move(task));
 
         return resultFuture;
     }
 
+    /**
+    * Fire-and-forget version of addTask. Results have to be written to memory owned by the caller,
+    * which can wait for its tasks with a WaitGroup. The callable must not throw
+    */
+    template<typename Func>
+    void submit(Func&& f)
+    {
+        Task* task = acquireTask();
+        *task = Task(std::forward<Func>(f));
+
+        numPendingTasks++;
+        enqueue(task);
+    }
+    [[nodiscard]] int getNumThreads() const
+    {
+        return numThreads;
+    }
+
 private:
-    void worker()
+    Task* acquireTask()
+    {
+        if (auto task = freeTasks.tryDequeue(); task.has_value()) return task.value();
+        return new Task();
+    }
+
+    void releaseTask(Task* task)
+    {
+        task->reset();
+        if (!freeTasks.tryEnqueue(task)) delete task;
+    }
+
+    void enqueue(Task* task)
+    {
+        if (currentWorker.pool == this) workers[currentWorker.index].tasks.push(task);
+        else injectedTasks.enqueue(std::move(task));
+
+        numQueuedTasks.fetch_add(1, std::memory_order_seq_cst);
+        wakeWorker();
+    }
+
+    void wakeWorker()
+    {
+        if (numParked.load(std::memory_order_seq_cst) == 0) return;
+
+        // Taking the lock ensures the parked worker is already waiting and doesn't miss the notification
+        std::lock_guard<std::mutex> lg(parkMutex);
+        parkCv.notify_one();
+    }
+
+    Task* findTask(int self, uint32_t& randomState)
     {
-        while (enabled)
+        Task* task = nullptr;
+
+        if (workers[self].tasks.pop(task)) return task;
+
+        if (auto injected = injectedTasks.tryDequeue(); injected.has_value()) return injected.value();
+
+        // Start stealing at a random worker so thieves don't all go after the same victim
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 17;
+        randomState ^= randomState << 5;
+        const int start = static_cast<int>(randomState % numThreads);
+
+        for (int i = 0; i < numThreads; i++)
         {
-            std::function<void()> task;
+            const int victim = (start + i) % numThreads;
+            if (victim != self && workers[victim].tasks.steal(task)) return task;
+        }
 
-            auto taskOptional = tasks.dequeue();
-            if (!taskOptional.has_value())
+        return nullptr;
+    }
+
+    void worker(int index)
+    {
+        currentWorker = {this, index};
+        uint32_t randomState = 2463534242u + index;
+
+        while (true)
+        {
+            Task* task = findTask(index, randomState);
+
+            if (task != nullptr)
+            {
+                numQueuedTasks.fetch_sub(1, std::memory_order_relaxed);
+                (*task)();
+                releaseTask(task);
+                numPendingTasks--;
                 continue;
-            
-            task = taskOptional.value();
-            task();
-            numPendingTasks--;
+            }
+
+            std::unique_lock<std::mutex> ul(parkMutex);
+            numParked.fetch_add(1, std::memory_order_seq_cst);
+
+            // Only exit once all queued tasks have run, so no future is left without a result
+            if (!enabled && numQueuedTasks.load(std::memory_order_seq_cst) == 0)
+            {
+                numParked.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+
+            parkCv.wait(ul, [this]() {
+                return numQueuedTasks.load(std::memory_order_seq_cst) > 0 || !enabled;
+            });
+            numParked.fetch_sub(1, std::memory_order_relaxed);
         }
     }
 
+    void shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lg(parkMutex);
+            enabled = false;
+        }
+        parkCv.notify_all();
+        injectedTasks.close();
+        joinThreads();
+
+        while (auto task = freeTasks.tryDequeue()) delete task.value();
+    }
+
     void joinThreads()
     {
         for (int i = 0; i < threads.size(); i++)
@@ -89,3 +234,5 @@ private:
         threads.clear();
     }
 };
+
+inline thread_local ThreadPool::WorkerContext ThreadPool::currentWorker;
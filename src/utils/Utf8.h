@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+* Encoding and decoding of UTF-8, which file names usually are in, although Linux allows any bytes in them
+*/
+class Utf8
+{
+public:
+    // U+FFFD, which replaces bytes that aren't valid UTF-8
+    static constexpr uint32_t replacementCharacter = 0xfffd;
+
+    static void append(std::string& out, uint32_t codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            out += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            out += static_cast<char>(0xc0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+        else if (codePoint < 0x10000)
+        {
+            out += static_cast<char>(0xe0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+        else
+        {
+            out += static_cast<char>(0xf0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+    }
+
+    /**
+    * Decode the code point at `in` and return its length, or 0 if the bytes aren't valid UTF-8
+    */
+    static size_t decode(const unsigned char* in, size_t available, uint32_t& codePoint)
+    {
+        size_t length;
+        uint32_t minimum;
+
+        if (in[0] < 0x80) { codePoint = in[0]; return 1; }
+        else if ((in[0] & 0xe0) == 0xc0) { length = 2; minimum = 0x80; codePoint = in[0] & 0x1f; }
+        else if ((in[0] & 0xf0) == 0xe0) { length = 3; minimum = 0x800; codePoint = in[0] & 0x0f; }
+        else if ((in[0] & 0xf8) == 0xf0) { length = 4; minimum = 0x10000; codePoint = in[0] & 0x07; }
+        else return 0;
+
+        if (length > available) return 0;
+
+        for (size_t i = 1; i < length; i++)
+        {
+            if ((in[i] & 0xc0) != 0x80) return 0;
+            codePoint = (codePoint << 6) | (in[i] & 0x3f);
+        }
+
+        // Overlong encodings, surrogates and values past the last code point
+        if (codePoint < minimum || (codePoint >= 0xd800 && codePoint <= 0xdfff) || codePoint > 0x10ffff) return 0;
+
+        return length;
+    }
+
+    static bool isValid(std::string_view text)
+    {
+        const unsigned char* in = reinterpret_cast<const unsigned char*>(text.data());
+        const unsigned char* end = in + text.size();
+        uint32_t codePoint;
+
+        while (in < end)
+        {
+            const size_t length = decode(in, static_cast<size_t>(end - in), codePoint);
+            if (length == 0) return false;
+            in += length;
+        }
+
+        return true;
+    }
+
+    /**
+    * Append `text` to `out` with every byte that isn't part of a valid UTF-8 sequence replaced by U+FFFD
+    */
+    static void appendValid(std::string& out, std::string_view text)
+    {
+        const unsigned char* in = reinterpret_cast<const unsigned char*>(text.data());
+        const unsigned char* end = in + text.size();
+        uint32_t codePoint;
+
+        while (in < end)
+        {
+            const size_t length = decode(in, static_cast<size_t>(end - in), codePoint);
+
+            if (length == 0)
+            {
+                append(out, replacementCharacter);
+                in++;
+                continue;
+            }
+
+            out.append(reinterpret_cast<const char*>(in), length);
+            in += length;
+        }
+    }
+};
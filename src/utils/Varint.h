@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+* LEB128 variable-length integers: 7 bits per byte, lowest bits first, with the high bit set on every byte but the last.
+* Small numbers, like shared prefix lengths and deltas between sorted numbers, take a single byte
+*/
+class Varint
+{
+public:
+    static constexpr size_t maxLength = 10;
+
+    static void append(std::string& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out += static_cast<char>((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+
+    /**
+    * Decode the number at `in` and return the position after it. The caller has to make sure the number is complete
+    */
+    static const unsigned char* read(const unsigned char* in, uint64_t& value)
+    {
+        value = 0;
+        unsigned int shift = 0;
+
+        while (*in & 0x80)
+        {
+            value |= static_cast<uint64_t>(*in++ & 0x7f) << shift;
+            shift += 7;
+        }
+        value |= static_cast<uint64_t>(*in++) << shift;
+
+        return in;
+    }
+
+    /**
+    * Same as read, but returns nullptr if the number doesn't end before `end` or is longer than maxLength
+    */
+    static const unsigned char* read(const unsigned char* in, const unsigned char* end, uint64_t& value)
+    {
+        value = 0;
+        unsigned int shift = 0;
+
+        for (size_t length = 0; in < end && length < maxLength; length++)
+        {
+            value |= static_cast<uint64_t>(*in & 0x7f) << shift;
+            if ((*in++ & 0x80) == 0) return in;
+            shift += 7;
+        }
+
+        return nullptr;
+    }
+};
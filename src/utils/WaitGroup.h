@@ -0,0 +1,43 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+/**
+* Waits until a number of tasks, e.g. ones added with ThreadPool::submit, are done
+*/
+class WaitGroup
+{
+private:
+    int count = 0;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+public:
+    explicit WaitGroup(int count = 0)
+        : count(count)
+    {
+    }
+
+    WaitGroup(const WaitGroup&) = delete;
+    WaitGroup& operator=(const WaitGroup&) = delete;
+
+    void add(int n = 1)
+    {
+        std::lock_guard<std::mutex> lg(mutex);
+        count += n;
+    }
+
+    void done()
+    {
+        // Notify while holding the lock, since the waiting thread may destroy the group as soon as it sees zero
+        std::lock_guard<std::mutex> lg(mutex);
+        if (--count == 0) cv.notify_all();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> ul(mutex);
+        cv.wait(ul, [this]() {return count == 0;});
+    }
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/**
+* Chase-Lev work-stealing deque (in the formulation for weak memory models by Lê et al.).
+* Only the owning thread may push and pop, at the bottom. Any thread may steal, from the top.
+* The buffer grows when full; old buffers are kept until the deque is destroyed since thieves might still read from them.
+*/
+template<typename T>
+class WorkStealingDeque
+{
+    static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque stores its items in atomics, so they have to be trivially copyable");
+
+private:
+    struct Buffer
+    {
+        int64_t capacity;
+        int64_t mask;
+        std::unique_ptr<std::atomic<T>[]> items;
+
+        explicit Buffer(int64_t capacity)
+            : capacity(capacity), mask(capacity - 1), items(std::make_unique<std::atomic<T>[]>(capacity))
+        {
+        }
+
+        // Release/acquire on the items themselves publishes whatever they point to, which is free on x86
+        // and keeps thread sanitizers from reporting the handover as a race
+        T get(int64_t i) const
+        {
+            return items[i & mask].load(std::memory_order_acquire);
+        }
+
+        void put(int64_t i, T item)
+        {
+            items[i & mask].store(item, std::memory_order_release);
+        }
+    };
+
+    alignas(64) std::atomic<int64_t> top = 0;
+    alignas(64) std::atomic<int64_t> bottom = 0;
+    alignas(64) std::atomic<Buffer*> buffer;
+    std::vector<std::unique_ptr<Buffer>> buffers;
+
+public:
+    explicit WorkStealingDeque(int64_t initialCapacity = 256)
+    {
+        // The capacity has to be a power of two for the index mask
+        int64_t capacity = 1;
+        while (capacity < initialCapacity) capacity <<= 1;
+
+        buffers.emplace_back(std::make_unique<Buffer>(capacity));
+        buffer.store(buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    /**
+    * Owner only
+    */
+    void push(T item)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Buffer* buf = buffer.load(std::memory_order_relaxed);
+
+        if (b - t > buf->capacity - 1) buf = grow(buf, t, b);
+
+        buf->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    /**
+    * Owner only. Takes the most recently pushed item
+    */
+    bool pop(T& item)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Buffer* buf = buffer.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            // Empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        item = buf->get(b);
+        if (t == b)
+        {
+            // Last item, so race against thieves for it
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+
+        return true;
+    }
+
+    /**
+    * Any thread. Takes the oldest item
+    */
+    bool steal(T& item)
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b) return false;
+
+        Buffer* buf = buffer.load(std::memory_order_acquire);
+        item = buf->get(t);
+
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool isEmpty() const
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_relaxed);
+        return b <= t;
+    }
+
+private:
+    Buffer* grow(Buffer* oldBuffer, int64_t t, int64_t b)
+    {
+        auto newBuffer = std::make_unique<Buffer>(oldBuffer->capacity * 2);
+        for (int64_t i = t; i < b; i++) newBuffer->put(i, oldBuffer->get(i));
+
+        Buffer* buf = newBuffer.get();
+        buffers.emplace_back(std::move(newBuffer));
+        buffer.store(buf, std::memory_order_release);
+
+        return buf;
+    }
+};
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "../src/matcher/SubstringMatcher.h"
+
+namespace
+{
+    int failures = 0;
+
+    void expectFolded(std::string_view text, std::string_view expected, const std::string& name)
+    {
+        std::string folded;
+        SubstringMatcher::foldUtf8(text, folded);
+        if (folded == expected) return;
+
+        std::cerr << name << ": expected \"" << expected << "\", got \"" << folded << "\"\n";
+        failures++;
+    }
+
+    void expectMatch(std::string_view name, std::string_view term, bool expected)
+    {
+        if (SubstringMatcher(term).matches(name) == expected) return;
+
+        std::cerr << "'" << term << "' in '" << name << "': expected " << (expected ? "a match" : "no match") << "\n";
+        failures++;
+    }
+}
+
+int main()
+{
+    // One case per block
+    expectFolded("ABC", "abc", "ASCII");
+    expectFolded("ÄÖÜ", "äöü", "Latin-1 Supplement");
+    expectFolded("ŁĘŚ", "łęś", "Latin Extended-A");
+    expectFolded("ȘȚ", "șț", "Latin Extended-B");
+    expectFolded("ǄǅǇ", "ǆǆǉ", "Latin Extended-B digraphs");
+    expectFolded("ΣΩ", "σω", "Greek");
+    expectFolded("ϘϮ", "ϙϯ", "Greek archaic letters");
+    expectFolded("Ἀθ", "ἀθ", "Greek Extended");
+    expectFolded("ЖЀ", "жѐ", "Cyrillic");
+    expectFolded("Ԁ", "ԁ", "Cyrillic Supplement");
+    expectFolded("Ա", "ա", "Armenian");
+    expectFolded("Ⴀ", "ⴀ", "Georgian");
+    expectFolded("Ა", "ა", "Georgian Mtavruli");
+    expectFolded("ꭰᏸ", "ᎠᏰ", "Cherokee");
+    expectFolded("Ḁ", "ḁ", "Latin Extended Additional");
+    expectFolded("ⰀⲀ", "ⰰⲁ", "Glagolitic and Coptic");
+    expectFolded("\u2126\u212a\u212b", "ωkå", "Letterlike Symbols");
+    expectFolded("Ａ", "ａ", "Halfwidth and Fullwidth Forms");
+    expectFolded("𐐀", "𐐨", "Deseret");
+
+    // Mappings to several characters
+    expectFolded("ßẞ", "ssss", "sharp s");
+    expectFolded("İ", "i̇", "dotted capital I");
+    expectFolded("ᾈ", "ἀι", "Greek with prosgegrammeni");
+    expectFolded("ﬁ", "fi", "ligature");
+
+    // Bytes which aren't valid UTF-8 are kept
+    expectFolded("a\xff" "B", "a\xff" "b", "invalid UTF-8");
+
+    expectMatch("ȘCOALĂ", "școală", true);
+    expectMatch("Ἀθῆναι", "ἀθῆναι", true);
+    expectMatch("Straße.txt", "STRASSE", true);
+    expectMatch("sun.txt", "ſun", true);
+    expectMatch("KELVIN.txt", "Kelvin", true);
+    expectMatch("notes.txt", "ſun", false);
+
+    return failures == 0 ? 0 : 1;
+}
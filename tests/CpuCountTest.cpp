@@ -0,0 +1,105 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "../src/utils/CpuCount.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    int failures = 0;
+
+    void expectEqual(int actual, int expected, const std::string& name)
+    {
+        if (actual == expected) return;
+
+        std::cerr << name << ": expected " << expected << ", got " << actual << "\n";
+        failures++;
+    }
+
+    void writeFile(const fs::path& path, const std::string& content)
+    {
+        fs::create_directories(path.parent_path());
+        std::ofstream(path) << content;
+    }
+
+    /**
+    * Fake cgroup v2 mount and /proc/self/cgroup file in a temporary directory
+    */
+    struct FakeCgroup
+    {
+        fs::path dir;
+        fs::path root;
+        fs::path procCgroupFile;
+
+        FakeCgroup(const std::string& name, const std::string& procCgroup)
+            : dir(fs::temp_directory_path() / ("ogy_cpu_count_test_" + name)), root(dir / "cgroup"), procCgroupFile(dir / "proc_cgroup")
+        {
+            fs::remove_all(dir);
+            fs::create_directories(root);
+            writeFile(procCgroupFile, procCgroup);
+        }
+
+        ~FakeCgroup()
+        {
+            fs::remove_all(dir);
+        }
+
+        void setCpuMax(const std::string& cgroupPath, const std::string& content)
+        {
+            writeFile(root / cgroupPath / "cpu.max", content);
+        }
+
+        int getLimit() const
+        {
+            return CpuCount::getCgroupV2Limit(root.string(), procCgroupFile.string());
+        }
+    };
+}
+
+int main()
+{
+    {
+        // The container's cgroup is mounted as the root, so only the root's cpu.max exists
+        FakeCgroup cgroup("namespace_root", "0::/docker/abc\n");
+        cgroup.setCpuMax("", "200000 100000\n");
+        expectEqual(cgroup.getLimit(), 2, "namespace root");
+    }
+
+    {
+        // The lowest limit of the cgroup and its ancestors, rounded up
+        FakeCgroup cgroup("ancestors", "0::/user.slice/app\n");
+        cgroup.setCpuMax("user.slice/app", "max 100000\n");
+        cgroup.setCpuMax("user.slice", "250000 100000\n");
+        cgroup.setCpuMax("", "400000 100000\n");
+        expectEqual(cgroup.getLimit(), 3, "ancestors");
+    }
+
+    {
+        FakeCgroup cgroup("own_cgroup", "0::/app\n");
+        cgroup.setCpuMax("app", "50000 100000\n");
+        cgroup.setCpuMax("", "max 100000\n");
+        expectEqual(cgroup.getLimit(), 1, "own cgroup");
+    }
+
+    {
+        FakeCgroup cgroup("unlimited", "0::/\n");
+        cgroup.setCpuMax("", "max 100000\n");
+        expectEqual(cgroup.getLimit(), 0, "unlimited");
+    }
+
+    {
+        // Only cgroup v1 hierarchies
+        FakeCgroup cgroup("v1", "4:cpu,cpuacct:/app\n");
+        cgroup.setCpuMax("", "200000 100000\n");
+        expectEqual(cgroup.getLimit(), 0, "cgroup v1");
+    }
+
+    expectEqual(CpuCount::parseThreadCount("8"), 8, "thread count");
+    expectEqual(CpuCount::parseThreadCount("0"), 0, "zero thread count");
+    expectEqual(CpuCount::parseThreadCount("4x"), 0, "invalid thread count");
+
+    return failures == 0 ? 0 : 1;
+}